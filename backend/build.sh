@@ -10,4 +10,4 @@ fi
 LIBMONGOC_DIR="./third_party/mongo-c-driver/_build/src/libmongoc"
 LIBBSON_DIR="./third_party/mongo-c-driver/_build/src/libbson"
 
-cc -o backend -DMONGOC_STATIC -DBSON_STATIC -fPIC -D_DEFAULT_SOURCE -D_POSIX_C_SOURCE=200809L -Wall -Wextra -Werror -Wno-unused-value -I./third_party/mongo-c-driver/_build/src/libbson/src/ -I./third_party/mongo-c-driver/_build/src/libmongoc/src/ -I./third_party/mongo-c-driver/src/libmongoc/src/ -I./third_party/mongo-c-driver/src/libbson/src/ -L$LIBMONGOC_DIR -L$LIBBSON_DIR -Wl,-rpath=$LIBMONGOC_DIR -Wl,-rpath=$LIBBSON_DIR -lmongoc2 -lbson2 -g main.c http.c db.c common.c json.c
+cc -o backend -DMONGOC_STATIC -DBSON_STATIC -fPIC -D_DEFAULT_SOURCE -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L -Wall -Wextra -Werror -Wno-unused-value -pthread -I./third_party/mongo-c-driver/_build/src/libbson/src/ -I./third_party/mongo-c-driver/_build/src/libmongoc/src/ -I./third_party/mongo-c-driver/src/libmongoc/src/ -I./third_party/mongo-c-driver/src/libbson/src/ -L$LIBMONGOC_DIR -L$LIBBSON_DIR -Wl,-rpath=$LIBMONGOC_DIR -Wl,-rpath=$LIBBSON_DIR -lmongoc2 -lbson2 -g main.c http.c db.c common.c json.c scan.c cache.c schema.c number.c metrics.c
@@ -0,0 +1,285 @@
+#include "cache.h"
+
+#include <pthread.h>
+
+#define PROJECT_CACHE_BUCKETS_COUNT 4096
+#define PROJECT_CACHE_MAX_ENTRIES 16384
+#define PROJECT_LIST_CACHE_MAX_SIZE (8 * 1024 * 1024)
+
+typedef struct project_cache_entry {
+    u64 Hash;
+    project_entity Project;
+    string_view Json;
+
+    struct project_cache_entry *NextInBucket;
+
+    // NOTE(oleh): Least recently used entries are evicted first.
+    struct project_cache_entry *Older;
+    struct project_cache_entry *Newer;
+} project_cache_entry;
+
+static pthread_mutex_t ProjectCacheLock = PTHREAD_MUTEX_INITIALIZER;
+
+static project_cache_entry *ProjectCacheBuckets[PROJECT_CACHE_BUCKETS_COUNT];
+static project_cache_entry *ProjectCacheOldest;
+static project_cache_entry *ProjectCacheNewest;
+static uz ProjectCacheCount;
+static u64 ProjectCacheGeneration;
+
+static project_list *ProjectListCache;
+static u64 ProjectListCacheGeneration;
+
+static u64 ProjectCacheHits;
+static u64 ProjectCacheMisses;
+static u64 ProjectCacheEvictions;
+static u64 ProjectListCacheHits;
+static u64 ProjectListCacheMisses;
+
+static project_cache_entry **ProjectCacheFindSlot(u64 Hash, string_view Id) {
+    project_cache_entry **Slot = &ProjectCacheBuckets[Hash % PROJECT_CACHE_BUCKETS_COUNT];
+    while (*Slot != NULL) {
+        if ((*Slot)->Hash == Hash && StringViewEqual((*Slot)->Project.Id, Id)) break;
+        Slot = &(*Slot)->NextInBucket;
+    }
+    return Slot;
+}
+
+static void ProjectCacheUnlink(project_cache_entry *Entry) {
+    if (Entry->Older != NULL) Entry->Older->Newer = Entry->Newer;
+    else ProjectCacheOldest = Entry->Newer;
+
+    if (Entry->Newer != NULL) Entry->Newer->Older = Entry->Older;
+    else ProjectCacheNewest = Entry->Older;
+
+    Entry->Older = NULL;
+    Entry->Newer = NULL;
+}
+
+static void ProjectCacheLinkNewest(project_cache_entry *Entry) {
+    Entry->Older = ProjectCacheNewest;
+    Entry->Newer = NULL;
+
+    if (ProjectCacheNewest != NULL) ProjectCacheNewest->Newer = Entry;
+    else ProjectCacheOldest = Entry;
+
+    ProjectCacheNewest = Entry;
+}
+
+static void ProjectCacheRemove(project_cache_entry **Slot) {
+    project_cache_entry *Entry = *Slot;
+    *Slot = Entry->NextInBucket;
+
+    ProjectCacheUnlink(Entry);
+    --ProjectCacheCount;
+    free(Entry);
+}
+
+static string_view ProjectCacheCopy(u8 **Cursor, string_view Value) {
+    string_view Result = {.Items = *Cursor, .Count = Value.Count};
+    memcpy(*Cursor, Value.Items, Value.Count);
+    *Cursor += Value.Count;
+    return Result;
+}
+
+static string_view ProjectCacheCopyToArena(arena *Arena, string_view Value) {
+    string_view Result = {.Items = ArenaPush(Arena, Value.Count), .Count = Value.Count};
+    memcpy(Result.Items, Value.Items, Value.Count);
+    return Result;
+}
+
+b32 ProjectCacheGet(arena *Arena, string_view Id, project_entity *Project, string_view *Json, u64 *Generation) {
+    u64 Hash = HashFnv1(Id);
+
+    pthread_mutex_lock(&ProjectCacheLock);
+
+    project_cache_entry *Entry = *ProjectCacheFindSlot(Hash, Id);
+    if (Entry == NULL) {
+        *Generation = ProjectCacheGeneration;
+        ++ProjectCacheMisses;
+        pthread_mutex_unlock(&ProjectCacheLock);
+        return 0;
+    }
+
+    ++ProjectCacheHits;
+
+    ProjectCacheUnlink(Entry);
+    ProjectCacheLinkNewest(Entry);
+
+#define X(Type, Field) Project->Field = ProjectCacheCopyToArena(Arena, Entry->Project.Field);
+    DECLARE_PROJECT_ENTITY
+#undef X
+
+    *Json = ProjectCacheCopyToArena(Arena, Entry->Json);
+
+    pthread_mutex_unlock(&ProjectCacheLock);
+    return 1;
+}
+
+void ProjectCachePut(u64 Generation, const project_entity *Project, string_view Json) {
+    // NOTE(oleh): The entry is a single allocation, the strings follow the header.
+    uz EntrySize = sizeof(project_cache_entry) + Json.Count;
+#define X(Type, Field) EntrySize += Project->Field.Count;
+    DECLARE_PROJECT_ENTITY
+#undef X
+
+    project_cache_entry *Entry = malloc(EntrySize);
+    if (Entry == NULL) return;
+
+    u8 *Cursor = (u8 *)(Entry + 1);
+
+#define X(Type, Field) Entry->Project.Field = ProjectCacheCopy(&Cursor, Project->Field);
+    DECLARE_PROJECT_ENTITY
+#undef X
+
+    Entry->Json = ProjectCacheCopy(&Cursor, Json);
+    Entry->Hash = HashFnv1(Entry->Project.Id);
+
+    pthread_mutex_lock(&ProjectCacheLock);
+
+    if (Generation != ProjectCacheGeneration) {
+        pthread_mutex_unlock(&ProjectCacheLock);
+        free(Entry);
+        return;
+    }
+
+    project_cache_entry **Slot = ProjectCacheFindSlot(Entry->Hash, Entry->Project.Id);
+    if (*Slot != NULL) ProjectCacheRemove(Slot);
+
+    if (ProjectCacheCount == PROJECT_CACHE_MAX_ENTRIES) {
+        project_cache_entry *Oldest = ProjectCacheOldest;
+        ProjectCacheRemove(ProjectCacheFindSlot(Oldest->Hash, Oldest->Project.Id));
+        ++ProjectCacheEvictions;
+    }
+
+    // NOTE(oleh): The slot may have moved if the evicted entry shared the bucket.
+    Slot = ProjectCacheFindSlot(Entry->Hash, Entry->Project.Id);
+    Entry->NextInBucket = NULL;
+    *Slot = Entry;
+
+    ProjectCacheLinkNewest(Entry);
+    ++ProjectCacheCount;
+
+    pthread_mutex_unlock(&ProjectCacheLock);
+}
+
+void ProjectCacheInvalidate(string_view Id) {
+    u64 Hash = HashFnv1(Id);
+
+    pthread_mutex_lock(&ProjectCacheLock);
+
+    ++ProjectCacheGeneration;
+
+    project_cache_entry **Slot = ProjectCacheFindSlot(Hash, Id);
+    if (*Slot != NULL) ProjectCacheRemove(Slot);
+
+    pthread_mutex_unlock(&ProjectCacheLock);
+}
+
+project_cache_stats ProjectCacheGetStats(void) {
+    pthread_mutex_lock(&ProjectCacheLock);
+
+    project_cache_stats Stats = {
+        .Hits = ProjectCacheHits,
+        .Misses = ProjectCacheMisses,
+        .Evictions = ProjectCacheEvictions,
+        .Count = ProjectCacheCount,
+        .ListHits = ProjectListCacheHits,
+        .ListMisses = ProjectListCacheMisses,
+    };
+
+    pthread_mutex_unlock(&ProjectCacheLock);
+    return Stats;
+}
+
+u64 ProjectCacheGetGeneration(void) {
+    pthread_mutex_lock(&ProjectCacheLock);
+    u64 Generation = ProjectCacheGeneration;
+    pthread_mutex_unlock(&ProjectCacheLock);
+    return Generation;
+}
+
+b32 ProjectListCacheAcquire(u64 Generation, project_list **List) {
+    pthread_mutex_lock(&ProjectCacheLock);
+
+    b32 Result = ProjectListCache != NULL && ProjectListCacheGeneration == Generation;
+    if (Result) {
+        ++ProjectListCacheHits;
+        __atomic_add_fetch(&ProjectListCache->References, 1, __ATOMIC_RELAXED);
+        *List = ProjectListCache;
+    } else {
+        ++ProjectListCacheMisses;
+    }
+
+    pthread_mutex_unlock(&ProjectCacheLock);
+    return Result;
+}
+
+void ProjectListRelease(project_list *List) {
+    if (List == NULL) return;
+    if (__atomic_sub_fetch(&List->References, 1, __ATOMIC_ACQ_REL) == 0) free(List);
+}
+
+void ProjectListFillBegin(project_list_fill *Fill, u64 Generation) {
+    Fill->Generation = Generation;
+    Fill->List = NULL;
+    Fill->Capacity = 0;
+    Fill->TooLarge = 0;
+}
+
+void ProjectListFillAppend(project_list_fill *Fill, string_view Json) {
+    if (Fill->TooLarge) return;
+
+    uz Count = Fill->List != NULL ? Fill->List->Count : 0;
+
+    if (Count + Json.Count > PROJECT_LIST_CACHE_MAX_SIZE) {
+        free(Fill->List);
+        Fill->List = NULL;
+        Fill->TooLarge = 1;
+        return;
+    }
+
+    if (Count + Json.Count > Fill->Capacity) {
+        uz NewCapacity = (Fill->Capacity + 1) * 2;
+        if (NewCapacity < Count + Json.Count) NewCapacity = Count + Json.Count;
+
+        project_list *NewList = realloc(Fill->List, sizeof(project_list) + NewCapacity);
+        if (NewList == NULL) {
+            free(Fill->List);
+            Fill->List = NULL;
+            Fill->TooLarge = 1;
+            return;
+        }
+
+        NewList->Count = Count;
+        Fill->List = NewList;
+        Fill->Capacity = NewCapacity;
+    }
+
+    memcpy(Fill->List->Items + Count, Json.Items, Json.Count);
+    Fill->List->Count = Count + Json.Count;
+}
+
+void ProjectListFillEnd(project_list_fill *Fill, b32 Commit) {
+    project_list *Garbage = Fill->List;
+
+    if (Commit && !Fill->TooLarge && Fill->List != NULL) {
+        // NOTE(oleh): The one reference belongs to the cache.
+        Fill->List->References = 1;
+
+        pthread_mutex_lock(&ProjectCacheLock);
+
+        if (Fill->Generation == ProjectCacheGeneration) {
+            Garbage = ProjectListCache;
+            ProjectListCache = Fill->List;
+            ProjectListCacheGeneration = Fill->Generation;
+        }
+
+        pthread_mutex_unlock(&ProjectCacheLock);
+
+        if (Garbage != ProjectListCache) ProjectListRelease(Garbage);
+    } else {
+        free(Garbage);
+    }
+
+    Fill->List = NULL;
+}
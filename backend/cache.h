@@ -0,0 +1,59 @@
+#ifndef CACHE_H_
+#define CACHE_H_
+
+#include "common.h"
+#include "db.h"
+
+// NOTE(oleh): Projects by Id together with their serialized JSON, shared by all the worker threads.
+// Reads that miss go to the database and fill the cache afterwards. Every mutation bumps a
+// generation counter, fills that started before the last mutation are dropped, so a slow read
+// can never put back an entity that was just changed.
+
+// NOTE(oleh): Lookups of the whole list are counted apart from the ones by Id.
+typedef struct {
+    u64 Hits;
+    u64 Misses;
+    u64 Evictions;
+    uz Count;
+    u64 ListHits;
+    u64 ListMisses;
+} project_cache_stats;
+
+// NOTE(oleh): On a hit the entity and the JSON are copied into `Arena`. On a miss `Generation`
+// is set to the value `ProjectCachePut` has to be called with.
+b32 ProjectCacheGet(arena *Arena, string_view Id, project_entity *Project, string_view *Json, u64 *Generation);
+void ProjectCachePut(u64 Generation, const project_entity *Project, string_view Json);
+
+void ProjectCacheInvalidate(string_view Id);
+
+project_cache_stats ProjectCacheGetStats(void);
+
+// NOTE(oleh): The whole serialized project list, only valid for the generation it was built at.
+// It is assembled while the response streams out and dropped once it grows past the size limit.
+// Once built the list never changes, a hit takes a reference to it and sends it as is, the
+// list is freed when the cache and every response that still points into it let go of it.
+
+u64 ProjectCacheGetGeneration(void);
+
+typedef struct {
+    u32 References;
+    uz Count;
+    u8 Items[];
+} project_list;
+
+b32 ProjectListCacheAcquire(u64 Generation, project_list **List);
+void ProjectListRelease(project_list *List);
+
+typedef struct {
+    u64 Generation;
+    project_list *List;
+    uz Capacity;
+    b32 TooLarge;
+} project_list_fill;
+
+void ProjectListFillBegin(project_list_fill *Fill, u64 Generation);
+void ProjectListFillAppend(project_list_fill *Fill, string_view Json);
+// NOTE(oleh): Frees the fill, its bytes only replace the cached list if `Commit` is set.
+void ProjectListFillEnd(project_list_fill *Fill, b32 Commit);
+
+#endif // CACHE_H_
@@ -1,18 +1,86 @@
 #include "common.h"
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <time.h>
 
-static arena TempArena;
+static uz ArenaTotalCommitted;
 
-#define TEMP_ARENA_CAPACITY (4l * 1024l * 1024l)
+void ArenaInit(arena *Arena, uz Capacity) {
+    void *Items = mmap(NULL, Capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (Items == MAP_FAILED) PANIC_FMT("Could not reserve %zu bytes for an arena", Capacity);
 
-arena *GetTempArena(void) {
-    if (TempArena.Items == NULL) {
-        ArenaInit(&TempArena, TEMP_ARENA_CAPACITY);
-    } else {
-        ArenaReset(&TempArena);
+    Arena->Items = Items;
+    Arena->LastAlloc = NULL;
+    Arena->Capacity = Capacity;
+    Arena->Offset = 0;
+    Arena->Committed = 0;
+    Arena->HighWater = 0;
+}
+
+void ArenaCommit(arena *Arena, uz End) {
+    uz NewCommitted = AlignForward(End, ARENA_COMMIT_GRANULARITY);
+    if (NewCommitted > Arena->Capacity) NewCommitted = Arena->Capacity;
+    if (NewCommitted <= Arena->Committed) return;
+
+    if (mprotect(Arena->Items + Arena->Committed, NewCommitted - Arena->Committed, PROT_READ | PROT_WRITE) != 0) {
+        PANIC_FMT("Could not commit %zu bytes of an arena", NewCommitted - Arena->Committed);
+    }
+
+    __atomic_add_fetch(&ArenaTotalCommitted, NewCommitted - Arena->Committed, __ATOMIC_RELAXED);
+    Arena->Committed = NewCommitted;
+}
+
+void ArenaDecommitUnused(arena *Arena) {
+    uz Keep = AlignForward(Arena->Offset > ARENA_RETAINED_SIZE ? Arena->Offset : ARENA_RETAINED_SIZE, ARENA_COMMIT_GRANULARITY);
+    if (Keep >= Arena->Committed) return;
+
+    u8 *Start = Arena->Items + Keep;
+    uz Size = Arena->Committed - Keep;
+
+    // NOTE(oleh): The pages read back as zeroes if they ever get committed again.
+    madvise(Start, Size, MADV_DONTNEED);
+    mprotect(Start, Size, PROT_NONE);
+
+    __atomic_sub_fetch(&ArenaTotalCommitted, Size, __ATOMIC_RELAXED);
+    Arena->Committed = Keep;
+}
+
+uz ArenaGetTotalCommitted(void) {
+    return __atomic_load_n(&ArenaTotalCommitted, __ATOMIC_RELAXED);
+}
+
+#define SCRATCH_ARENAS_COUNT 2
+#define SCRATCH_ARENA_CAPACITY (256l * 1024l * 1024l)
+
+static _Thread_local arena ScratchArenas[SCRATCH_ARENAS_COUNT];
+
+scratch_arena ScratchBegin(arena **Conflicts, uz ConflictsCount) {
+    for (uz ArenaIndex = 0; ArenaIndex < SCRATCH_ARENAS_COUNT; ++ArenaIndex) {
+        arena *Arena = &ScratchArenas[ArenaIndex];
+
+        b32 Conflicting = 0;
+        for (uz ConflictIndex = 0; ConflictIndex < ConflictsCount; ++ConflictIndex) {
+            if (Conflicts[ConflictIndex] == Arena) {
+                Conflicting = 1;
+                break;
+            }
+        }
+
+        if (Conflicting) continue;
+
+        if (Arena->Items == NULL) ArenaInit(Arena, SCRATCH_ARENA_CAPACITY);
+        return (scratch_arena) {.Arena = Arena, .SavePoint = ArenaSave(Arena)};
     }
 
-    return &TempArena;
+    PANIC("Every scratch arena conflicts with the arenas in use");
+}
+
+uz ScratchGetHighWater(void) {
+    uz HighWater = 0;
+    for (uz ArenaIndex = 0; ArenaIndex < SCRATCH_ARENAS_COUNT; ++ArenaIndex) {
+        if (ScratchArenas[ArenaIndex].HighWater > HighWater) HighWater = ScratchArenas[ArenaIndex].HighWater;
+    }
+    return HighWater;
 }
 
 b32 ReadFullFile(arena *Arena, const char *Path, string_view *OutContents) {
@@ -49,3 +117,9 @@ u64 HashFnv1(string_view Input) {
 
     return Hash;
 }
+
+u64 GetMonotonicTimeNs(void) {
+    struct timespec Now;
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+    return (u64)Now.tv_sec * 1000000000 + (u64)Now.tv_nsec;
+}
@@ -7,6 +7,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <stddef.h>
 
 #define ASSERT(X) do {                                                  \
         if (!(X)) {                                                     \
@@ -15,6 +16,8 @@
         }                                                               \
     } while (0)
 
+#define ARRAY_COUNT(Array) (sizeof(Array) / sizeof((Array)[0]))
+
 #define MEMORY_ZERO(Ptr, Size) (memset((Ptr), 0, (Size)))
 
 #define STRUCT_ZERO(Ptr) MEMORY_ZERO((Ptr), sizeof(*(Ptr)))
@@ -79,6 +82,21 @@ static inline b32 StringViewEqualCStr(string_view Sv, const char *CStr) {
     return 1;
 }
 
+static inline u8 AsciiToLower(u8 Char) {
+    return (Char >= 'A' && Char <= 'Z') ? Char + ('a' - 'A') : Char;
+}
+
+static inline b32 StringViewEqualIgnoreCaseCStr(string_view Sv, const char *CStr) {
+    uz CStrLength = strlen(CStr);
+    if (Sv.Count != CStrLength) return 0;
+
+    for (uz I = 0; I < Sv.Count; ++I) {
+        if (AsciiToLower(Sv.Items[I]) != AsciiToLower(CStr[I])) return 0;
+    }
+
+    return 1;
+}
+
 static inline b32 StringViewEqual(string_view Lhs, string_view Rhs) {
     if (Lhs.Count != Rhs.Count) return 0;
 
@@ -89,37 +107,60 @@ static inline b32 StringViewEqual(string_view Lhs, string_view Rhs) {
     return 1;
 }
 
+// NOTE(oleh): An arena reserves `Capacity` bytes of address space up front and only commits
+// pages as `Offset` moves into them, so a big reservation costs nothing until it is used.
+// Whatever an arena committed past `ARENA_RETAINED_SIZE` goes back to the OS on reset, so a
+// single huge request does not pin memory for the lifetime of the process.
 typedef struct {
     u8 *Items;
     void *LastAlloc;
     uz Capacity;
     uz Offset;
+    uz Committed;
+    uz HighWater;
 } arena;
 
+#define ARENA_COMMIT_GRANULARITY (64l * 1024l)
+#define ARENA_RETAINED_SIZE (1024l * 1024l)
+
 static inline uz AlignForward(uz Size, uz Alignment) {
     return Size + ((Alignment - (Size & (Alignment - 1))) & (Alignment - 1));
 }
 
-static inline void *ArenaPush(arena *Arena, uz Size) {
-    Size = AlignForward(Size, sizeof(uz));
+void ArenaInit(arena *Arena, uz Capacity);
+void ArenaCommit(arena *Arena, uz End);
+// NOTE(oleh): Gives back the committed pages past the current offset, keeping `ARENA_RETAINED_SIZE` around.
+void ArenaDecommitUnused(arena *Arena);
+
+// NOTE(oleh): Bytes committed by all the arenas of the process.
+uz ArenaGetTotalCommitted(void);
+
+static inline void ArenaTrackHighWater(arena *Arena) {
+    if (Arena->Offset > Arena->HighWater) Arena->HighWater = Arena->Offset;
+}
+
+// NOTE(oleh): Makes `Size` bytes past the offset writable without allocating them, for code that
+// writes straight into the arena and bumps the offset by itself.
+static inline u8 *ArenaEnsure(arena *Arena, uz Size) {
     uz AvailableBytes = Arena->Capacity - Arena->Offset;
     if (AvailableBytes < Size) PANIC_FMT("Arena out of memory for requested size %zu!", Size);
 
-    void *Ptr = Arena->Items + Arena->Offset;
+    if (Arena->Offset + Size > Arena->Committed) ArenaCommit(Arena, Arena->Offset + Size);
+    return Arena->Items + Arena->Offset;
+}
+
+static inline void *ArenaPush(arena *Arena, uz Size) {
+    Size = AlignForward(Size, sizeof(uz));
+
+    void *Ptr = ArenaEnsure(Arena, Size);
     Arena->Offset += Size;
     Arena->LastAlloc = Ptr;
+    ArenaTrackHighWater(Arena);
     return Ptr;
 }
 
 #define ARENA_PUSH_ZERO(Arena, Size) (MEMORY_ZERO(ArenaPush((Arena), (Size)), (Size)))
 
-static inline void ArenaInit(arena *Arena, uz Capacity) {
-    Arena->Capacity = Capacity;
-    Arena->Offset = 0;
-    Arena->Items = (u8 *)calloc(Capacity, sizeof(u8));
-    Arena->LastAlloc = NULL;
-}
-
 static inline string_view ArenaFormat(arena *Arena, const char *Fmt, ...) {
     va_list Args;
     va_start(Args, Fmt);
@@ -147,13 +188,48 @@ static inline void *ArenaRealloc(arena *Arena, void *OldPtr, uz OldSize, uz NewS
     return NewPtr;
 }
 
-void ArenaPop(arena *, uz);
+static inline void ArenaPop(arena *Arena, uz Size) {
+    Size = AlignForward(Size, sizeof(uz));
+    ArenaTrackHighWater(Arena);
+    Arena->Offset = Size < Arena->Offset ? Arena->Offset - Size : 0;
+    Arena->LastAlloc = NULL;
+}
+
+// NOTE(oleh): Everything pushed after `ArenaSave` is thrown away by the matching `ArenaRestore`.
+static inline uz ArenaSave(arena *Arena) {
+    return Arena->Offset;
+}
+
+static inline void ArenaRestore(arena *Arena, uz SavePoint) {
+    ASSERT(SavePoint <= Arena->Offset);
+    ArenaTrackHighWater(Arena);
+    Arena->Offset = SavePoint;
+    Arena->LastAlloc = NULL;
+}
 
 static inline void ArenaReset(arena *Arena) {
-    Arena->Offset = 0;
+    ArenaRestore(Arena, 0);
+    if (Arena->Committed > ARENA_RETAINED_SIZE) ArenaDecommitUnused(Arena);
 }
 
-arena *GetTempArena(void);
+// NOTE(oleh): Every thread owns a couple of scratch arenas for allocations that do not outlive
+// a function. A function that also allocates its results in an arena it was handed passes that
+// arena as a conflict, so its scratch memory can never overlap the results of its caller.
+// Scopes nest, `ScratchEnd` frees everything pushed since the matching `ScratchBegin`.
+typedef struct {
+    arena *Arena;
+    uz SavePoint;
+} scratch_arena;
+
+scratch_arena ScratchBegin(arena **Conflicts, uz ConflictsCount);
+
+// NOTE(oleh): The most any scratch arena of the calling thread ever held.
+uz ScratchGetHighWater(void);
+
+static inline void ScratchEnd(scratch_arena Scratch) {
+    if (Scratch.SavePoint == 0) ArenaReset(Scratch.Arena);
+    else ArenaRestore(Scratch.Arena, Scratch.SavePoint);
+}
 
 #define ARENA_NEW(Arena, Type) ((Type *)MEMORY_ZERO(ArenaPush((Arena), sizeof(Type)), sizeof(Type)))
 
@@ -166,6 +242,8 @@ static inline char *StringViewCloneCStr(arena *Arena, string_view Sv) {
 
 b32 ReadFullFile(arena *Arena, const char *Path, string_view *OutContents);
 
+u64 GetMonotonicTimeNs(void);
+
 #define DEFAULT_ARRAY_CAPACITY 7
 
 #define ARRAY_INIT(Arena, Array) do {                                   \
@@ -1,6 +1,10 @@
 #include "db.h"
+#include "cache.h"
+#include "metrics.h"
 
 #include <mongoc/mongoc.h>
+#include <sys/random.h>
+#include <errno.h>
 
 #define MONGO_CONNECTION_STRING_VAR "MONGO_CONNECTION_STRING"
 #define MONGO_DATABASE "databaz"
@@ -9,28 +13,152 @@
 #define MONGO_USERS_COLLECTION "users"
 #define MONGO_FEATURES_COLLECTION "features"
 
-static mongoc_client_t *MongoClient;
-static mongoc_database_t *MongoDatabase;
+#define MONGO_ID_INDEX "Id_unique"
 
-static mongoc_collection_t *MongoProjectsCollection;
-static mongoc_collection_t *MongoUsersCollection;
-static mongoc_collection_t *MongoFeaturesCollection;
+#define MONGO_POOL_MAX_SIZE_VAR "MONGO_POOL_MAX_SIZE"
+#define MONGO_POOL_DEFAULT_MAX_SIZE 100
+
+#define MONGO_BATCH_SIZE_VAR "MONGO_BATCH_SIZE"
+#define MONGO_DEFAULT_BATCH_SIZE 1000
+
+// NOTE(oleh): Mongo clients and collection handles must not be shared between threads, so every
+// database call leases a client from the pool for its duration and gives it back afterwards.
+// Once `MaxSize` clients are out, the next caller blocks until one comes back.
+static mongoc_client_pool_t *MongoClientPool;
+static u32 MongoPoolMaxSize;
+
+// NOTE(oleh): How many documents a cursor gets from the server per round trip.
+static u32 MongoBatchSize;
+
+static u64 MongoPoolAcquisitions;
+static u64 MongoPoolExhaustions;
+static u64 MongoPoolWaitNs;
+static u64 MongoPoolMaxWaitNs;
+static u32 MongoPoolInUse;
+
+// NOTE(oleh): The latency of a call is taken from the moment it asks for a client to the moment
+// it gives the client back, so time spent waiting on an exhausted pool shows up too.
+typedef struct {
+    mongoc_client_t *Client;
+    mongoc_collection_t *Collection;
+    db_call Call;
+    u64 StartNs;
+} db_lease;
+
+static void DbAcquire(db_call Call, const char *CollectionName, db_lease *Lease) {
+    Lease->Call = Call;
+    Lease->StartNs = GetMonotonicTimeNs();
+
+    mongoc_client_t *Client = mongoc_client_pool_try_pop(MongoClientPool);
+
+    if (Client == NULL) {
+        __atomic_add_fetch(&MongoPoolExhaustions, 1, __ATOMIC_RELAXED);
+
+        u64 WaitStart = GetMonotonicTimeNs();
+        Client = mongoc_client_pool_pop(MongoClientPool);
+        u64 Waited = GetMonotonicTimeNs() - WaitStart;
+
+        __atomic_add_fetch(&MongoPoolWaitNs, Waited, __ATOMIC_RELAXED);
+
+        u64 MaxWait = __atomic_load_n(&MongoPoolMaxWaitNs, __ATOMIC_RELAXED);
+        while (Waited > MaxWait &&
+               !__atomic_compare_exchange_n(&MongoPoolMaxWaitNs, &MaxWait, Waited, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    }
+
+    __atomic_add_fetch(&MongoPoolAcquisitions, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&MongoPoolInUse, 1, __ATOMIC_RELAXED);
+
+    Lease->Client = Client;
+    Lease->Collection = mongoc_client_get_collection(Client, MONGO_DATABASE, CollectionName);
+}
+
+static void DbRelease(db_lease *Lease) {
+    mongoc_collection_destroy(Lease->Collection);
+    mongoc_client_pool_push(MongoClientPool, Lease->Client);
+    __atomic_sub_fetch(&MongoPoolInUse, 1, __ATOMIC_RELAXED);
+
+    MetricsRecordDbCall(Lease->Call, GetMonotonicTimeNs() - Lease->StartNs);
+
+    Lease->Client = NULL;
+    Lease->Collection = NULL;
+}
+
+db_pool_stats DbGetPoolStats(void) {
+    return (db_pool_stats) {
+        .Acquisitions = __atomic_load_n(&MongoPoolAcquisitions, __ATOMIC_RELAXED),
+        .Exhaustions = __atomic_load_n(&MongoPoolExhaustions, __ATOMIC_RELAXED),
+        .WaitNs = __atomic_load_n(&MongoPoolWaitNs, __ATOMIC_RELAXED),
+        .MaxWaitNs = __atomic_load_n(&MongoPoolMaxWaitNs, __ATOMIC_RELAXED),
+        .InUse = __atomic_load_n(&MongoPoolInUse, __ATOMIC_RELAXED),
+        .MaxSize = MongoPoolMaxSize,
+    };
+}
+
+static u32 DbGetEnvCount(const char *Var, u32 Default) {
+    const char *CountString = getenv(Var);
+    if (CountString == NULL) return Default;
+
+    char *CountEnd;
+    long Count = strtol(CountString, &CountEnd, 10);
+    if (*CountEnd != '\0' || Count <= 0 || Count > INT32_MAX) {
+        PANIC_FMT("Expected a positive number in var '%s', got '%s'", Var, CountString);
+    }
+
+    return (u32)Count;
+}
+
+// NOTE(oleh): Creating an index that already exists with the same keys and options does nothing.
+static void DbEnsureIndex(mongoc_client_t *Client, const char *CollectionName, const char *IndexName, const bson_t *Keys, b32 Unique) {
+    mongoc_collection_t *Collection = mongoc_client_get_collection(Client, MONGO_DATABASE, CollectionName);
+
+    bson_t *IndexOptions = BCON_NEW("name", BCON_UTF8(IndexName), "unique", BCON_BOOL(Unique));
+    mongoc_index_model_t *IndexModel = mongoc_index_model_new(Keys, IndexOptions);
+
+    bson_error_t IndexError;
+    b32 IndexOk = mongoc_collection_create_indexes_with_opts(Collection, &IndexModel, 1, NULL, NULL, &IndexError);
+    if (!IndexOk) {
+        PANIC_FMT("Could not create index '%s' on collection '%s': %s", IndexName, CollectionName, IndexError.message);
+    }
+
+    mongoc_index_model_destroy(IndexModel);
+    bson_destroy(IndexOptions);
+    mongoc_collection_destroy(Collection);
+}
 
 void DbInit(void) {
     mongoc_init();
 
-    const char *MongoConnectionString = getenv(MONGO_CONNECTION_STRING_VAR);
-    if (MongoConnectionString == NULL) {
+    const char *ConnectionString = getenv(MONGO_CONNECTION_STRING_VAR);
+    if (ConnectionString == NULL) {
         PANIC_FMT("Expected the MongoDB connection string (var '%s') to be set in the environment", MONGO_CONNECTION_STRING_VAR);
     }
 
-    MongoClient = mongoc_client_new(MongoConnectionString);
+    MongoPoolMaxSize = DbGetEnvCount(MONGO_POOL_MAX_SIZE_VAR, MONGO_POOL_DEFAULT_MAX_SIZE);
+    MongoBatchSize = DbGetEnvCount(MONGO_BATCH_SIZE_VAR, MONGO_DEFAULT_BATCH_SIZE);
+
+    bson_error_t UriError;
+    mongoc_uri_t *Uri = mongoc_uri_new_with_error(ConnectionString, &UriError);
+    if (Uri == NULL) {
+        PANIC_FMT("Could not parse the MongoDB connection string: %s", UriError.message);
+    }
+
+    MongoClientPool = mongoc_client_pool_new(Uri);
+    mongoc_uri_destroy(Uri);
+
+    if (MongoClientPool == NULL) {
+        PANIC("Could not create a MongoDB client pool from the connection string");
+    }
+
+    mongoc_client_pool_set_error_api(MongoClientPool, MONGOC_ERROR_API_VERSION_2);
+    mongoc_client_pool_max_size(MongoClientPool, MongoPoolMaxSize);
+
+    mongoc_client_t *Client = mongoc_client_pool_pop(MongoClientPool);
 
     bson_t *PingCommand = BCON_NEW("ping", BCON_INT32(1));
     bson_t PingReply = BSON_INITIALIZER;
     bson_error_t PingError;
 
-    b32 PingOk = mongoc_client_command_simple(MongoClient, "admin", PingCommand, NULL, &PingReply, &PingError);
+    b32 PingOk = mongoc_client_command_simple(Client, "admin", PingCommand, NULL, &PingReply, &PingError);
     if (!PingOk) {
         PANIC_FMT("Could not send a ping command to the database: %s", PingError.message);
     }
@@ -38,11 +166,40 @@ void DbInit(void) {
     bson_destroy(&PingReply);
     bson_destroy(PingCommand);
 
-    MongoDatabase = mongoc_client_get_database(MongoClient, MONGO_DATABASE);
+    // NOTE(oleh): Lookups filter on these, and the unique ones are what catches duplicates on insert.
+    bson_t *IdKeys = BCON_NEW("Id", BCON_INT32(1));
+    DbEnsureIndex(Client, MONGO_PROJECTS_COLLECTION, MONGO_ID_INDEX, IdKeys, 1);
+    DbEnsureIndex(Client, MONGO_USERS_COLLECTION, MONGO_ID_INDEX, IdKeys, 1);
+    DbEnsureIndex(Client, MONGO_FEATURES_COLLECTION, MONGO_ID_INDEX, IdKeys, 1);
+    bson_destroy(IdKeys);
+
+    // NOTE(oleh): Names are not unique, a lookup by name gets whichever project the index has first.
+    bson_t *NameKeys = BCON_NEW("Name", BCON_INT32(1));
+    DbEnsureIndex(Client, MONGO_PROJECTS_COLLECTION, "Name", NameKeys, 0);
+    bson_destroy(NameKeys);
+
+    bson_t *LoginKeys = BCON_NEW("FirstName", BCON_INT32(1), "LastName", BCON_INT32(1));
+    DbEnsureIndex(Client, MONGO_USERS_COLLECTION, "FirstName_LastName_unique", LoginKeys, 1);
+    bson_destroy(LoginKeys);
+
+    // NOTE(oleh): A project board is a single range scan over this, already sorted by column. The
+    // Id makes the order total, so a board can be read a batch at a time starting after any feature.
+    bson_t *BoardKeys = BCON_NEW("ProjectId", BCON_INT32(1), "State", BCON_INT32(1), "Priority", BCON_INT32(1), "Id", BCON_INT32(1));
+    DbEnsureIndex(Client, MONGO_FEATURES_COLLECTION, "ProjectId_State_Priority_Id", BoardKeys, 0);
+    bson_destroy(BoardKeys);
+
+    mongoc_client_pool_push(MongoClientPool, Client);
+}
+
+static db_insert_result DbInsertDocument(mongoc_collection_t *Collection, const bson_t *Document) {
+    bson_error_t Error;
+    if (mongoc_collection_insert_one(Collection, Document, NULL, NULL, &Error)) return DB_INSERT_OK;
+    if (Error.code != MONGOC_ERROR_DUPLICATE_KEY) return DB_INSERT_FAILED;
 
-    MongoProjectsCollection = mongoc_database_get_collection(MongoDatabase, MONGO_PROJECTS_COLLECTION);
-    MongoUsersCollection = mongoc_database_get_collection(MongoDatabase, MONGO_USERS_COLLECTION);
-    MongoFeaturesCollection = mongoc_database_get_collection(MongoDatabase, MONGO_FEATURES_COLLECTION);
+    // NOTE(oleh): The server only says which index was violated in the message,
+    // e.g. "E11000 duplicate key error collection: databaz.users index: Id_unique dup key: ...".
+    if (strstr(Error.message, "index: " MONGO_ID_INDEX " ") != NULL) return DB_INSERT_DUPLICATE_ID;
+    return DB_INSERT_DUPLICATE;
 }
 
 static const char *BsonEncode_string_view(arena *Arena, string_view Sv) {
@@ -50,106 +207,381 @@ static const char *BsonEncode_string_view(arena *Arena, string_view Sv) {
     return (BCON_UTF8(CStr));
 }
 
-b32 DbInsertProject(const project_entity *ProjectEntity) {
-    arena *TempArena = GetTempArena();
-
-    // Id, Name, Description
-#define X(Type, Name) #Name, BsonEncode_##Type(TempArena, ProjectEntity->Name),
-bson_t *Document = bcon_new(NULL,
-                            DECLARE_PROJECT_ENTITY
-                            NULL);
-#undef X
-
-    b32 Result = mongoc_collection_insert_one(MongoProjectsCollection, Document, NULL, NULL, NULL);
-    bson_destroy(Document);
-    return Result;
+static b32 BsonAppend_string_view(bson_t *Document, const char *Name, u32 NameLength, const void *In) {
+    const string_view *Value = In;
+    return bson_append_utf8(Document, Name, (int)NameLength, (const char *)Value->Items, (int)Value->Count);
 }
 
-static inline b32 BsonIterGet_string_view(bson_iter_t *Iterator, arena *Arena, string_view *Out) {
+// NOTE(oleh): Without an arena the view points straight into the document.
+static b32 BsonDecode_string_view(const bson_iter_t *Iterator, arena *Arena, void *Out) {
     u32 Length = 0;
     const char *CStr = bson_iter_utf8(Iterator, &Length);
     if (CStr == NULL) return 0;
 
-    Out->Items = ArenaPush(Arena, Length);
-    Out->Count = Length;
-    memcpy(Out->Items, CStr, Length);
+    string_view *Result = Out;
+
+    if (Arena == NULL) {
+        Result->Items = (u8 *)CStr;
+        Result->Count = Length;
+        return 1;
+    }
+
+    Result->Items = ArenaPush(Arena, Length);
+    Result->Count = Length;
+    memcpy(Result->Items, CStr, Length);
     return 1;
 }
 
-b32 DbGetProjectById(arena *Arena, string_view Id, project_entity *ProjectEntity) {
-    arena *TempArena = GetTempArena();
+// NOTE(oleh): Enums are stored as their index.
+static b32 BsonAppendEnum(bson_t *Document, const char *Name, u32 NameLength, u32 Value) {
+    return bson_append_int32(Document, Name, (int)NameLength, (s32)Value);
+}
 
-    b32 Result;
+static b32 BsonDecodeEnum(const bson_iter_t *Iterator, u32 Count, u32 *Out) {
+    if (bson_iter_type(Iterator) != BSON_TYPE_INT32) return 0;
 
-    const char *IdBson = BsonEncode_string_view(TempArena, Id);
-    bson_t *Query = BCON_NEW("Id", IdBson);
-    bson_t *QueryOptions = BCON_NEW("limit", BCON_INT32(1));
+    s32 Value = bson_iter_int32(Iterator);
+    if (Value < 0 || (u32)Value >= Count) return 0;
 
-    mongoc_cursor_t *ResultsCursor = mongoc_collection_find_with_opts(MongoProjectsCollection, Query, QueryOptions, NULL);
+    *Out = (u32)Value;
+    return 1;
+}
 
-    const bson_t *ProjectDoc;
-    if (!mongoc_cursor_next(ResultsCursor, &ProjectDoc)) {
-        Result = 0;
-        goto Cleanup;
+static b32 BsonAppend_feature_priority(bson_t *Document, const char *Name, u32 NameLength, const void *In) {
+    return BsonAppendEnum(Document, Name, NameLength, *(const feature_priority *)In);
+}
+
+static b32 BsonDecode_feature_priority(const bson_iter_t *Iterator, arena *Arena, void *Out) {
+    (void)Arena;
+
+    u32 Index;
+    if (!BsonDecodeEnum(Iterator, PRIORITY_HIGH + 1, &Index)) return 0;
+    *(feature_priority *)Out = (feature_priority)Index;
+    return 1;
+}
+
+static b32 BsonAppend_feature_state(bson_t *Document, const char *Name, u32 NameLength, const void *In) {
+    return BsonAppendEnum(Document, Name, NameLength, *(const feature_state *)In);
+}
+
+static b32 BsonDecode_feature_state(const bson_iter_t *Iterator, arena *Arena, void *Out) {
+    (void)Arena;
+
+    u32 Index;
+    if (!BsonDecodeEnum(Iterator, STATE_DONE + 1, &Index)) return 0;
+    *(feature_state *)Out = (feature_state)Index;
+    return 1;
+}
+
+// NOTE(oleh): The same tables drive the documents written on insert, the projection sent with a
+// query and the decoding of the documents that come back, so Mongo only ever sends the fields
+// the entity has.
+typedef b32 (*bson_field_encoder)(bson_t *Document, const char *Name, u32 NameLength, const void *In);
+typedef b32 (*bson_field_decoder)(const bson_iter_t *Iterator, arena *Arena, void *Out);
+
+typedef struct {
+    const char *Name;
+    u32 NameLength;
+    bson_field_encoder Encode;
+    bson_field_decoder Decode;
+    uz Offset;
+} bson_field;
+
+#define BSON_FIELD(Struct, Type, Field) {                               \
+        .Name = #Field,                                                 \
+        .NameLength = sizeof(#Field) - 1,                               \
+        .Encode = BsonAppend_##Type,                                    \
+        .Decode = BsonDecode_##Type,                                    \
+        .Offset = offsetof(Struct, Field),                              \
+    },
+
+static const bson_field BsonFields_project_entity[] = {
+#define X(Type, Field) BSON_FIELD(project_entity, Type, Field)
+    DECLARE_PROJECT_ENTITY
+#undef X
+};
+
+static const bson_field BsonFields_user_entity[] = {
+#define X(Type, Field) BSON_FIELD(user_entity, Type, Field)
+    DECLARE_USER_ENTITY
+#undef X
+};
+
+static const bson_field BsonFields_feature_entity[] = {
+#define X(Type, Field) BSON_FIELD(feature_entity, Type, Field)
+    DECLARE_FEATURE_ENTITY
+#undef X
+};
+
+static bson_t *BsonEncodeDocument(const bson_field *Fields, uz FieldsCount, const void *In) {
+    bson_t *Document = bson_new();
+
+    for (uz FieldIndex = 0; FieldIndex < FieldsCount; ++FieldIndex) {
+        const bson_field *Field = &Fields[FieldIndex];
+        if (!Field->Encode(Document, Field->Name, Field->NameLength, (const u8 *)In + Field->Offset)) {
+            bson_destroy(Document);
+            return NULL;
+        }
     }
 
-    bson_iter_t DocIterator;
-    if (!bson_iter_init(&DocIterator, ProjectDoc)) {
-        Result = 0;
-        goto Cleanup;
+    return Document;
+}
+
+// NOTE(oleh): Bit N of a fields mask selects the N-th field of the table.
+#define BSON_ALL_FIELDS (~(u64)0)
+
+static void BsonAppendProjection(bson_t *Options, const bson_field *Fields, uz FieldsCount, u64 FieldsMask) {
+    bson_t Projection;
+    BSON_APPEND_DOCUMENT_BEGIN(Options, "projection", &Projection);
+
+    BSON_APPEND_INT32(&Projection, "_id", 0);
+    for (uz FieldIndex = 0; FieldIndex < FieldsCount; ++FieldIndex) {
+        if (!(FieldsMask & ((u64)1 << FieldIndex))) continue;
+        bson_append_int32(&Projection, Fields[FieldIndex].Name, (int)Fields[FieldIndex].NameLength, 1);
     }
 
-#define X(Type, Field)                                                  \
-    if (!bson_iter_find(&DocIterator, #Field)) {                        \
-        Result = 0;                                                     \
-        goto Cleanup;                                                   \
-    }                                                                   \
-    if (!BsonIterGet_##Type(&DocIterator, Arena, &ProjectEntity->Field)) { \
-        Result = 0;                                                     \
-        goto Cleanup;                                                   \
+    bson_append_document_end(Options, &Projection);
+}
+
+// NOTE(oleh): A single walk over the document, every key is looked up in `Fields`. Keys that are
+// not there or not in the mask are ignored, but every selected field has to be present exactly once.
+static b32 BsonDecodeDocument(const bson_t *Document, arena *Arena, const bson_field *Fields, uz FieldsCount, u64 FieldsMask, void *Out) {
+    ASSERT(FieldsCount <= 64);
+
+    bson_iter_t Iterator;
+    if (!bson_iter_init(&Iterator, Document)) return 0;
+
+    u64 SeenFields = 0;
+
+    while (bson_iter_next(&Iterator)) {
+        const char *Key = bson_iter_key(&Iterator);
+        u32 KeyLength = bson_iter_key_len(&Iterator);
+
+        for (uz FieldIndex = 0; FieldIndex < FieldsCount; ++FieldIndex) {
+            const bson_field *Field = &Fields[FieldIndex];
+            if (Field->NameLength != KeyLength || memcmp(Field->Name, Key, KeyLength) != 0) continue;
+
+            u64 FieldBit = (u64)1 << FieldIndex;
+            if (!(FieldsMask & FieldBit)) break;
+            if (SeenFields & FieldBit) return 0;
+            SeenFields |= FieldBit;
+
+            if (!Field->Decode(&Iterator, Arena, (u8 *)Out + Field->Offset)) return 0;
+            break;
+        }
     }
 
-    DECLARE_PROJECT_ENTITY
-#undef X
+    u64 AllFields = FieldsCount == 64 ? ~(u64)0 : ((u64)1 << FieldsCount) - 1;
+    return SeenFields == (FieldsMask & AllFields);
+}
+
+// NOTE(oleh): Options for a lookup that can match at most one document.
+static bson_t *DbSingleLookupOptions(const bson_field *Fields, uz FieldsCount) {
+    bson_t *Options = BCON_NEW("limit", BCON_INT32(1), "singleBatch", BCON_BOOL(1));
+    BsonAppendProjection(Options, Fields, FieldsCount, BSON_ALL_FIELDS);
+    return Options;
+}
+
+db_insert_result DbInsertProject(const project_entity *ProjectEntity) {
+    bson_t *Document = BsonEncodeDocument(BsonFields_project_entity, ARRAY_COUNT(BsonFields_project_entity), ProjectEntity);
+    if (Document == NULL) return DB_INSERT_FAILED;
+
+    db_lease Lease;
+    DbAcquire(DB_CALL_DbInsertProject, MONGO_PROJECTS_COLLECTION, &Lease);
+
+    db_insert_result Result = DbInsertDocument(Lease.Collection, Document);
+    bson_destroy(Document);
+    DbRelease(&Lease);
+
+    ProjectCacheInvalidate(ProjectEntity->Id);
+    return Result;
+}
 
-    Result = 1;
+// NOTE(oleh): Requests are matched back to the documents through an open addressing table of
+// their indices, repeated Ids are chained together and asked for only once.
+static b32 DbGetManyByIds(db_call Call, arena *Arena, const char *CollectionName,
+                          const bson_field *Fields, uz FieldsCount, u64 FieldsMask, uz IdOffset,
+                          const string_view *Ids, uz IdsCount, void *Out, uz EntitySize, b32 *Found) {
+    ASSERT(IdsCount < UINT32_MAX);
+
+    scratch_arena Scratch = ScratchBegin(&Arena, 1);
+
+    uz SlotsCount = 16;
+    while (SlotsCount < IdsCount * 2) SlotsCount *= 2;
+
+    u32 *Slots = ArenaPush(Scratch.Arena, sizeof(u32) * SlotsCount);
+    memset(Slots, 0xFF, sizeof(u32) * SlotsCount);
+
+    u32 *NextSame = ArenaPush(Scratch.Arena, sizeof(u32) * (IdsCount + 1));
+
+    bson_t *Query = bson_new();
+    bson_t Filter;
+    bson_t InIds;
+    BSON_APPEND_DOCUMENT_BEGIN(Query, "Id", &Filter);
+    BSON_APPEND_ARRAY_BEGIN(&Filter, "$in", &InIds);
+
+    u32 UniqueCount = 0;
+
+    for (uz IdIndex = 0; IdIndex < IdsCount; ++IdIndex) {
+        Found[IdIndex] = 0;
+        NextSame[IdIndex] = UINT32_MAX;
+
+        uz Slot = HashFnv1(Ids[IdIndex]) & (SlotsCount - 1);
+        while (Slots[Slot] != UINT32_MAX && !StringViewEqual(Ids[Slots[Slot]], Ids[IdIndex])) {
+            Slot = (Slot + 1) & (SlotsCount - 1);
+        }
+
+        if (Slots[Slot] != UINT32_MAX) {
+            u32 First = Slots[Slot];
+            NextSame[IdIndex] = NextSame[First];
+            NextSame[First] = (u32)IdIndex;
+            continue;
+        }
+
+        Slots[Slot] = (u32)IdIndex;
+
+        char Key[16];
+        int KeyLength = snprintf(Key, sizeof(Key), "%u", UniqueCount++);
+        bson_append_utf8(&InIds, Key, KeyLength, (const char *)Ids[IdIndex].Items, (int)Ids[IdIndex].Count);
+    }
+
+    bson_append_array_end(&Filter, &InIds);
+    bson_append_document_end(Query, &Filter);
+
+    bson_t *QueryOptions = BCON_NEW("batchSize", BCON_INT32((s32)MongoBatchSize));
+    BsonAppendProjection(QueryOptions, Fields, FieldsCount, FieldsMask);
+
+    db_lease Lease;
+    DbAcquire(Call, CollectionName, &Lease);
+
+    mongoc_cursor_t *ResultsCursor = mongoc_collection_find_with_opts(Lease.Collection, Query, QueryOptions, NULL);
+
+    b32 Result = 1;
+
+    u8 *Entity = ArenaPush(Scratch.Arena, EntitySize);
+    const bson_t *Document;
+
+    while (mongoc_cursor_next(ResultsCursor, &Document)) {
+        if (!BsonDecodeDocument(Document, Arena, Fields, FieldsCount, FieldsMask, Entity)) {
+            Result = 0;
+            break;
+        }
+
+        string_view Id = *(string_view *)(Entity + IdOffset);
+
+        uz Slot = HashFnv1(Id) & (SlotsCount - 1);
+        while (Slots[Slot] != UINT32_MAX && !StringViewEqual(Ids[Slots[Slot]], Id)) {
+            Slot = (Slot + 1) & (SlotsCount - 1);
+        }
+
+        for (u32 IdIndex = Slots[Slot]; IdIndex != UINT32_MAX; IdIndex = NextSame[IdIndex]) {
+            memcpy((u8 *)Out + IdIndex * EntitySize, Entity, EntitySize);
+            Found[IdIndex] = 1;
+        }
+    }
+
+    if (mongoc_cursor_error(ResultsCursor, NULL)) Result = 0;
+
+    mongoc_cursor_destroy(ResultsCursor);
+    DbRelease(&Lease);
 
-Cleanup:
     bson_destroy(Query);
+    bson_destroy(QueryOptions);
+    ScratchEnd(Scratch);
+
+    return Result;
+}
+
+b32 DbGetProjectsByIds(arena *Arena, const string_view *Ids, uz IdsCount, u64 Fields, project_entity *Out, b32 *Found) {
+    return DbGetManyByIds(DB_CALL_DbGetProjectsByIds, Arena, MONGO_PROJECTS_COLLECTION,
+                          BsonFields_project_entity, ARRAY_COUNT(BsonFields_project_entity),
+                          Fields | ((u64)1 << PROJECT_FIELD_Id), offsetof(project_entity, Id),
+                          Ids, IdsCount, Out, sizeof(project_entity), Found);
+}
+
+b32 DbGetUsersByIds(arena *Arena, const string_view *Ids, uz IdsCount, u64 Fields, user_entity *Out, b32 *Found) {
+    return DbGetManyByIds(DB_CALL_DbGetUsersByIds, Arena, MONGO_USERS_COLLECTION,
+                          BsonFields_user_entity, ARRAY_COUNT(BsonFields_user_entity),
+                          Fields | ((u64)1 << USER_FIELD_Id), offsetof(user_entity, Id),
+                          Ids, IdsCount, Out, sizeof(user_entity), Found);
+}
+
+static b32 DbFindProject(db_call Call, arena *Arena, const bson_t *Query, project_entity *ProjectEntity) {
+    db_lease Lease;
+    DbAcquire(Call, MONGO_PROJECTS_COLLECTION, &Lease);
+
+    bson_t *QueryOptions = DbSingleLookupOptions(BsonFields_project_entity, ARRAY_COUNT(BsonFields_project_entity));
+
+    mongoc_cursor_t *ResultsCursor = mongoc_collection_find_with_opts(Lease.Collection, Query, QueryOptions, NULL);
+
+    const bson_t *ProjectDoc;
+    b32 Result = mongoc_cursor_next(ResultsCursor, &ProjectDoc) &&
+        BsonDecodeDocument(ProjectDoc, Arena, BsonFields_project_entity, ARRAY_COUNT(BsonFields_project_entity), BSON_ALL_FIELDS, ProjectEntity);
+
     bson_destroy(QueryOptions);
     mongoc_cursor_destroy(ResultsCursor);
+    DbRelease(&Lease);
 
     return Result;
 }
 
+b32 DbGetProjectById(arena *Arena, string_view Id, project_entity *ProjectEntity) {
+    scratch_arena Scratch = ScratchBegin(&Arena, 1);
+
+    const char *IdBson = BsonEncode_string_view(Scratch.Arena, Id);
+    bson_t *Query = BCON_NEW("Id", IdBson);
+
+    b32 Result = DbFindProject(DB_CALL_DbGetProjectById, Arena, Query, ProjectEntity);
+
+    bson_destroy(Query);
+    ScratchEnd(Scratch);
+    return Result;
+}
+
+b32 DbGetProjectByName(arena *Arena, string_view Name, project_entity *ProjectEntity) {
+    scratch_arena Scratch = ScratchBegin(&Arena, 1);
+
+    const char *NameBson = BsonEncode_string_view(Scratch.Arena, Name);
+    bson_t *Query = BCON_NEW("Name", NameBson);
+
+    b32 Result = DbFindProject(DB_CALL_DbGetProjectByName, Arena, Query, ProjectEntity);
+
+    bson_destroy(Query);
+    ScratchEnd(Scratch);
+    return Result;
+}
+
 b32 DbUpdateProject(const project_update_entity *ProjectUpdate) {
     ASSERT(ProjectUpdate->Name.HasValue || ProjectUpdate->Description.HasValue);
 
+    db_lease Lease;
+    DbAcquire(DB_CALL_DbUpdateProject, MONGO_PROJECTS_COLLECTION, &Lease);
+
     b32 Result;
 
-    arena *TempArena = GetTempArena();
+    scratch_arena Scratch = ScratchBegin(NULL, 0);
 
-    const char *UpdateId = BsonEncode_string_view(TempArena, ProjectUpdate->Id);
+    const char *UpdateId = BsonEncode_string_view(Scratch.Arena, ProjectUpdate->Id);
     bson_t *Query = BCON_NEW("Id", UpdateId);
     bson_t *Update;
 
     // FIXME(oleh): This is so ugly because for whatever reason i get an assertion
     // error inside the Mongo driver when calling `bcon_append` :/.
     if (ProjectUpdate->Name.HasValue) {
-        const char *UpdateName = BsonEncode_string_view(TempArena, ProjectUpdate->Name.Value);
+        const char *UpdateName = BsonEncode_string_view(Scratch.Arena, ProjectUpdate->Name.Value);
 
         if (ProjectUpdate->Description.HasValue) {
-            const char *UpdateDescription = BsonEncode_string_view(TempArena, ProjectUpdate->Description.Value);
+            const char *UpdateDescription = BsonEncode_string_view(Scratch.Arena, ProjectUpdate->Description.Value);
             Update = BCON_NEW("$set", "{", "Name", UpdateName, "Description", UpdateDescription, "}");
         } else {
             Update = BCON_NEW("$set", "{", "Name", UpdateName, "}");
         }
     } else {
-        const char *UpdateDescription = BsonEncode_string_view(TempArena, ProjectUpdate->Description.Value);
+        const char *UpdateDescription = BsonEncode_string_view(Scratch.Arena, ProjectUpdate->Description.Value);
         Update = BCON_NEW("$set", "{", "Description", UpdateDescription, "}");
     }
 
-    if (!mongoc_collection_update_one(MongoProjectsCollection, Query, Update, NULL, NULL, NULL)) {
+    if (!mongoc_collection_update_one(Lease.Collection, Query, Update, NULL, NULL, NULL)) {
         Result = 0;
     } else {
         Result = 1;
@@ -157,145 +589,158 @@ b32 DbUpdateProject(const project_update_entity *ProjectUpdate) {
 
     bson_destroy(Query);
     bson_destroy(Update);
+    DbRelease(&Lease);
 
+    // NOTE(oleh): Even a failed write might have gone through, the cached copy is dropped either way.
+    ProjectCacheInvalidate(ProjectUpdate->Id);
+    ScratchEnd(Scratch);
     return Result;
 }
 
 b32 DbDeleteProjectById(string_view ProjectId) {
+    db_lease Lease;
+    DbAcquire(DB_CALL_DbDeleteProjectById, MONGO_PROJECTS_COLLECTION, &Lease);
+
     b32 Result;
 
-    arena *TempArena = GetTempArena();
+    scratch_arena Scratch = ScratchBegin(NULL, 0);
 
-    const char *DeleteId = BsonEncode_string_view(TempArena, ProjectId);
+    const char *DeleteId = BsonEncode_string_view(Scratch.Arena, ProjectId);
     bson_t *Query = BCON_NEW("Id", DeleteId);
 
-    if (!mongoc_collection_delete_one(MongoProjectsCollection, Query, NULL, NULL, NULL)) {
+    if (!mongoc_collection_delete_one(Lease.Collection, Query, NULL, NULL, NULL)) {
         Result = 0;
     } else {
         Result = 1;
     }
 
     bson_destroy(Query);
+    DbRelease(&Lease);
 
+    ProjectCacheInvalidate(ProjectId);
+    ScratchEnd(Scratch);
     return Result;
 }
 
-b32 DbGetAllProjects(arena *Arena, project_entity **Projects, uz *ProjectsCount) {
-    uz StartOffset = Arena->Offset;
+// NOTE(oleh): The cursor holds on to its client until it is closed. Opening, every step and
+// closing are timed as separate calls, the time in between belongs to whoever reads the cursor.
+static b32 DbCursorOpen(db_call Call, db_cursor *Cursor, const char *CollectionName, const bson_t *Query, const bson_t *QueryOptions) {
+    db_lease Lease;
+    DbAcquire(Call, CollectionName, &Lease);
 
-    b32 Result = 1;
+    Cursor->Handle = mongoc_collection_find_with_opts(Lease.Collection, Query, QueryOptions, NULL);
+    Cursor->Client = Lease.Client;
+    Cursor->Collection = Lease.Collection;
+    Cursor->Failed = 0;
 
-    bson_t Query;
-    bson_init(&Query);
+    if (Cursor->Handle == NULL) {
+        DbRelease(&Lease);
+        return 0;
+    }
 
-    mongoc_cursor_t *ResultsCursor = mongoc_collection_find_with_opts(MongoProjectsCollection, &Query, NULL, NULL);
+    MetricsRecordDbCall(Call, GetMonotonicTimeNs() - Lease.StartNs);
+    return 1;
+}
 
-    struct {
-        project_entity *Items;
-        uz Count;
-        uz Capacity;
-    } ProjectsArray;
-    ARRAY_INIT(Arena, &ProjectsArray);
+// NOTE(oleh): Pages are ranges of the unique Id index, so a page costs the same no matter how deep into the list it is.
+b32 DbProjectsCursorOpen(db_cursor *Cursor, const db_projects_page *Page) {
+    scratch_arena Scratch = ScratchBegin(NULL, 0);
 
-    const bson_t *ProjectDoc;
-    while (mongoc_cursor_next(ResultsCursor, &ProjectDoc)) {
-        bson_iter_t DocIterator;
-        if (!bson_iter_init(&DocIterator, ProjectDoc)) {
-            Result = 0;
-            goto Cleanup;
-        }
+    bson_t *Query;
+    if (Page->After.Count > 0) {
+        const char *AfterBson = BsonEncode_string_view(Scratch.Arena, Page->After);
+        Query = BCON_NEW("Id", "{", "$gt", AfterBson, "}");
+    } else {
+        Query = bson_new();
+    }
 
-        project_entity ProjectEntity;
+    bson_t *QueryOptions = BCON_NEW("sort", "{", "Id", BCON_INT32(1), "}");
 
-#define X(Type, Field)                                                  \
-        if (!bson_iter_find(&DocIterator, #Field)) {                    \
-            Result = 0;                                                 \
-            goto Cleanup;                                               \
-        }                                                               \
-        if (!BsonIterGet_##Type(&DocIterator, Arena, &ProjectEntity.Field)) { \
-            Result = 0;                                                 \
-            goto Cleanup;                                               \
-        }
+    u32 BatchSize = MongoBatchSize;
+    if (Page->Limit > 0) {
+        BSON_APPEND_INT64(QueryOptions, "limit", Page->Limit);
+        if (BatchSize > Page->Limit) BatchSize = Page->Limit;
+    }
 
-        DECLARE_PROJECT_ENTITY
-#undef X
+    BSON_APPEND_INT32(QueryOptions, "batchSize", (s32)BatchSize);
+    BsonAppendProjection(QueryOptions, BsonFields_project_entity, ARRAY_COUNT(BsonFields_project_entity), Page->Fields);
 
-       ARRAY_PUSH(Arena, &ProjectsArray, ProjectEntity);
-    }
+    b32 Result = DbCursorOpen(DB_CALL_DbProjectsCursorOpen, Cursor, MONGO_PROJECTS_COLLECTION, Query, QueryOptions);
+    Cursor->Fields = Page->Fields;
 
-Cleanup:
-    bson_destroy(&Query);
-    mongoc_cursor_destroy(ResultsCursor);
+    bson_destroy(Query);
+    bson_destroy(QueryOptions);
+    ScratchEnd(Scratch);
+    return Result;
+}
 
-    if (Result == 0) {
-        Arena->Offset = StartOffset;
-    } else {
-        *ProjectsCount = ProjectsArray.Count;
-        *Projects = ProjectsArray.Items;
+b32 DbProjectsCursorNext(db_cursor *Cursor, project_entity *ProjectEntity) {
+    if (Cursor->Failed) return 0;
+
+    u64 StartNs = GetMonotonicTimeNs();
+
+    const bson_t *ProjectDoc;
+    b32 Result = mongoc_cursor_next(Cursor->Handle, &ProjectDoc);
+
+    if (Result && !BsonDecodeDocument(ProjectDoc, NULL, BsonFields_project_entity, ARRAY_COUNT(BsonFields_project_entity), Cursor->Fields, ProjectEntity)) {
+        Cursor->Failed = 1;
+        Result = 0;
     }
 
+    MetricsRecordDbCall(DB_CALL_DbProjectsCursorNext, GetMonotonicTimeNs() - StartNs);
     return Result;
 }
 
-b32 DbGetUserByLogin(arena *Arena, string_view FirstName, string_view LastName, user_entity *UserEntity) {
-    arena *TempArena = GetTempArena();
+b32 DbCursorClose(db_cursor *Cursor) {
+    u64 StartNs = GetMonotonicTimeNs();
 
-    b32 Result;
+    b32 Result = !Cursor->Failed && !mongoc_cursor_error(Cursor->Handle, NULL);
+    mongoc_cursor_destroy(Cursor->Handle);
+    Cursor->Handle = NULL;
 
-    const char *FirstNameBson = BsonEncode_string_view(TempArena, FirstName);
-    const char *LastNameBson = BsonEncode_string_view(TempArena, LastName);
-    bson_t *Query = BCON_NEW("FirstName", FirstNameBson, "LastName", LastNameBson);
-    bson_t *QueryOptions = BCON_NEW("limit", BCON_INT32(1));
+    db_lease Lease = {.Client = Cursor->Client, .Collection = Cursor->Collection, .Call = DB_CALL_DbCursorClose, .StartNs = StartNs};
+    DbRelease(&Lease);
 
-    mongoc_cursor_t *ResultsCursor = mongoc_collection_find_with_opts(MongoUsersCollection, Query, QueryOptions, NULL);
+    return Result;
+}
 
-    const bson_t *UserDoc;
-    if (!mongoc_cursor_next(ResultsCursor, &UserDoc)) {
-        Result = 0;
-        goto Cleanup;
-    }
+b32 DbGetUserByLogin(arena *Arena, string_view FirstName, string_view LastName, user_entity *UserEntity) {
+    db_lease Lease;
+    DbAcquire(DB_CALL_DbGetUserByLogin, MONGO_USERS_COLLECTION, &Lease);
 
-    bson_iter_t DocIterator;
-    if (!bson_iter_init(&DocIterator, UserDoc)) {
-        Result = 0;
-        goto Cleanup;
-    }
+    scratch_arena Scratch = ScratchBegin(&Arena, 1);
 
-#define X(Type, Field)                                                  \
-    if (!bson_iter_find(&DocIterator, #Field)) {                        \
-    Result = 0;                                                     \
-    goto Cleanup;                                                   \
-    }                                                                   \
-    if (!BsonIterGet_##Type(&DocIterator, Arena, &UserEntity->Field)) { \
-    Result = 0;                                                     \
-    goto Cleanup;                                                   \
-    }
+    const char *FirstNameBson = BsonEncode_string_view(Scratch.Arena, FirstName);
+    const char *LastNameBson = BsonEncode_string_view(Scratch.Arena, LastName);
+    bson_t *Query = BCON_NEW("FirstName", FirstNameBson, "LastName", LastNameBson);
+    bson_t *QueryOptions = DbSingleLookupOptions(BsonFields_user_entity, ARRAY_COUNT(BsonFields_user_entity));
 
-DECLARE_USER_ENTITY
-#undef X
+    mongoc_cursor_t *ResultsCursor = mongoc_collection_find_with_opts(Lease.Collection, Query, QueryOptions, NULL);
 
-Result = 1;
+    const bson_t *UserDoc;
+    b32 Result = mongoc_cursor_next(ResultsCursor, &UserDoc) &&
+        BsonDecodeDocument(UserDoc, Arena, BsonFields_user_entity, ARRAY_COUNT(BsonFields_user_entity), BSON_ALL_FIELDS, UserEntity);
 
-Cleanup:
     bson_destroy(Query);
     bson_destroy(QueryOptions);
     mongoc_cursor_destroy(ResultsCursor);
+    DbRelease(&Lease);
+    ScratchEnd(Scratch);
 
     return Result;
 }
 
-b32 DbInsertUser(const user_entity *UserEntity) {
-    arena *TempArena = GetTempArena();
+db_insert_result DbInsertUser(const user_entity *UserEntity) {
+    bson_t *Document = BsonEncodeDocument(BsonFields_user_entity, ARRAY_COUNT(BsonFields_user_entity), UserEntity);
+    if (Document == NULL) return DB_INSERT_FAILED;
 
-    // Id, Name, Description
-#define X(Type, Name) #Name, BsonEncode_##Type(TempArena, UserEntity->Name),
-bson_t *Document = bcon_new(NULL,
-                            DECLARE_USER_ENTITY
-                            NULL);
-#undef X
+    db_lease Lease;
+    DbAcquire(DB_CALL_DbInsertUser, MONGO_USERS_COLLECTION, &Lease);
 
-    b32 Result = mongoc_collection_insert_one(MongoUsersCollection, Document, NULL, NULL, NULL);
+    db_insert_result Result = DbInsertDocument(Lease.Collection, Document);
     bson_destroy(Document);
+    DbRelease(&Lease);
+
     return Result;
 }
 
@@ -304,16 +749,18 @@ user_entity CreateUserWithRandomId(arena *Arena,
                                    string_view LastName,
                                    string_view Password,
                                    string_view Role) {
-    u32 Entropy = rand();
+    u64 Entropy;
+    while (getrandom(&Entropy, sizeof(Entropy), 0) != sizeof(Entropy)) {
+        if (errno != EINTR) PANIC_FMT("Could not get random bytes for a user Id: %s", strerror(errno));
+    }
 
-    u8 *IdBuffer = ArenaPush(Arena, 8);
+    u8 *IdBuffer = ArenaPush(Arena, 2 * sizeof(Entropy));
 
-    for (uz I = 0; I < 8; ++I) {
-        u8 Bits = Entropy & (0x0F << (I * 4));
-        IdBuffer[I] = 'a' + Bits;
+    for (uz I = 0; I < 2 * sizeof(Entropy); ++I) {
+        IdBuffer[I] = "0123456789abcdef"[(Entropy >> (I * 4)) & 0xF];
     }
 
-    string_view Id = {.Items = IdBuffer, .Count = 8};
+    string_view Id = {.Items = IdBuffer, .Count = 2 * sizeof(Entropy)};
 
     return (user_entity) {
         .Id = Id,
@@ -323,3 +770,155 @@ user_entity CreateUserWithRandomId(arena *Arena,
         .Role = Role,
     };
 }
+
+db_insert_result DbInsertFeature(const feature_entity *FeatureEntity) {
+    bson_t *Document = BsonEncodeDocument(BsonFields_feature_entity, ARRAY_COUNT(BsonFields_feature_entity), FeatureEntity);
+    if (Document == NULL) return DB_INSERT_FAILED;
+
+    db_lease Lease;
+    DbAcquire(DB_CALL_DbInsertFeature, MONGO_FEATURES_COLLECTION, &Lease);
+
+    db_insert_result Result = DbInsertDocument(Lease.Collection, Document);
+    bson_destroy(Document);
+    DbRelease(&Lease);
+
+    return Result;
+}
+
+b32 DbGetFeatureById(arena *Arena, string_view Id, feature_entity *FeatureEntity) {
+    db_lease Lease;
+    DbAcquire(DB_CALL_DbGetFeatureById, MONGO_FEATURES_COLLECTION, &Lease);
+
+    scratch_arena Scratch = ScratchBegin(&Arena, 1);
+
+    const char *IdBson = BsonEncode_string_view(Scratch.Arena, Id);
+    bson_t *Query = BCON_NEW("Id", IdBson);
+    bson_t *QueryOptions = DbSingleLookupOptions(BsonFields_feature_entity, ARRAY_COUNT(BsonFields_feature_entity));
+
+    mongoc_cursor_t *ResultsCursor = mongoc_collection_find_with_opts(Lease.Collection, Query, QueryOptions, NULL);
+
+    const bson_t *FeatureDoc;
+    b32 Result = mongoc_cursor_next(ResultsCursor, &FeatureDoc) &&
+        BsonDecodeDocument(FeatureDoc, Arena, BsonFields_feature_entity, ARRAY_COUNT(BsonFields_feature_entity), BSON_ALL_FIELDS, FeatureEntity);
+
+    bson_destroy(Query);
+    bson_destroy(QueryOptions);
+    mongoc_cursor_destroy(ResultsCursor);
+    DbRelease(&Lease);
+    ScratchEnd(Scratch);
+
+    return Result;
+}
+
+// NOTE(oleh): Writes reply with how many documents they touched, e.g. `{"matchedCount": 1, ...}`.
+static db_write_result DbWriteResult(b32 Ok, const bson_t *Reply, const char *CountField) {
+    if (!Ok) return DB_WRITE_FAILED;
+
+    bson_iter_t Iterator;
+    if (!bson_iter_init(&Iterator, Reply) || !bson_iter_find(&Iterator, CountField)) return DB_WRITE_FAILED;
+
+    return bson_iter_as_int64(&Iterator) == 0 ? DB_WRITE_NOT_FOUND : DB_WRITE_OK;
+}
+
+db_write_result DbUpdateFeature(const feature_entity *FeatureEntity) {
+    bson_t *Document = BsonEncodeDocument(BsonFields_feature_entity, ARRAY_COUNT(BsonFields_feature_entity), FeatureEntity);
+    if (Document == NULL) return DB_WRITE_FAILED;
+
+    db_lease Lease;
+    DbAcquire(DB_CALL_DbUpdateFeature, MONGO_FEATURES_COLLECTION, &Lease);
+
+    scratch_arena Scratch = ScratchBegin(NULL, 0);
+
+    const char *UpdateId = BsonEncode_string_view(Scratch.Arena, FeatureEntity->Id);
+    bson_t *Query = BCON_NEW("Id", UpdateId);
+
+    bson_t Reply;
+    b32 Ok = mongoc_collection_replace_one(Lease.Collection, Query, Document, NULL, &Reply, NULL);
+    db_write_result Result = DbWriteResult(Ok, &Reply, "matchedCount");
+
+    bson_destroy(&Reply);
+    bson_destroy(Query);
+    bson_destroy(Document);
+    DbRelease(&Lease);
+    ScratchEnd(Scratch);
+
+    return Result;
+}
+
+db_write_result DbDeleteFeatureById(string_view FeatureId) {
+    db_lease Lease;
+    DbAcquire(DB_CALL_DbDeleteFeatureById, MONGO_FEATURES_COLLECTION, &Lease);
+
+    scratch_arena Scratch = ScratchBegin(NULL, 0);
+
+    const char *DeleteId = BsonEncode_string_view(Scratch.Arena, FeatureId);
+    bson_t *Query = BCON_NEW("Id", DeleteId);
+
+    bson_t Reply;
+    b32 Ok = mongoc_collection_delete_one(Lease.Collection, Query, NULL, &Reply, NULL);
+    db_write_result Result = DbWriteResult(Ok, &Reply, "deletedCount");
+
+    bson_destroy(&Reply);
+    bson_destroy(Query);
+    DbRelease(&Lease);
+    ScratchEnd(Scratch);
+
+    return Result;
+}
+
+b32 DbProjectFeaturesCursorOpen(db_cursor *Cursor, string_view ProjectId, const feature_entity *After, u32 Limit) {
+    scratch_arena Scratch = ScratchBegin(NULL, 0);
+
+    const char *ProjectIdBson = BsonEncode_string_view(Scratch.Arena, ProjectId);
+
+    bson_t *Query;
+    if (After != NULL) {
+        // NOTE(oleh): Everything past `After` in (State, Priority, Id) order, each branch is a range of the index.
+        const char *AfterIdBson = BsonEncode_string_view(Scratch.Arena, After->Id);
+        Query = BCON_NEW("ProjectId", ProjectIdBson,
+                         "$or", "[",
+                         "{", "State", "{", "$gt", BCON_INT32((s32)After->State), "}", "}",
+                         "{", "State", BCON_INT32((s32)After->State), "Priority", "{", "$gt", BCON_INT32((s32)After->Priority), "}", "}",
+                         "{", "State", BCON_INT32((s32)After->State), "Priority", BCON_INT32((s32)After->Priority),
+                         "Id", "{", "$gt", AfterIdBson, "}", "}",
+                         "]");
+    } else {
+        Query = BCON_NEW("ProjectId", ProjectIdBson);
+    }
+
+    // NOTE(oleh): Sorting in index order lets the server walk the index instead of sorting in memory.
+    bson_t *QueryOptions = BCON_NEW("sort", "{", "State", BCON_INT32(1), "Priority", BCON_INT32(1), "Id", BCON_INT32(1), "}");
+
+    u32 BatchSize = MongoBatchSize;
+    if (Limit > 0) {
+        BSON_APPEND_INT64(QueryOptions, "limit", Limit);
+        if (BatchSize > Limit) BatchSize = Limit;
+    }
+
+    BSON_APPEND_INT32(QueryOptions, "batchSize", (s32)BatchSize);
+    BsonAppendProjection(QueryOptions, BsonFields_feature_entity, ARRAY_COUNT(BsonFields_feature_entity), BSON_ALL_FIELDS);
+
+    b32 Result = DbCursorOpen(DB_CALL_DbProjectFeaturesCursorOpen, Cursor, MONGO_FEATURES_COLLECTION, Query, QueryOptions);
+
+    bson_destroy(Query);
+    bson_destroy(QueryOptions);
+    ScratchEnd(Scratch);
+    return Result;
+}
+
+b32 DbFeaturesCursorNext(db_cursor *Cursor, feature_entity *FeatureEntity) {
+    if (Cursor->Failed) return 0;
+
+    u64 StartNs = GetMonotonicTimeNs();
+
+    const bson_t *FeatureDoc;
+    b32 Result = mongoc_cursor_next(Cursor->Handle, &FeatureDoc);
+
+    if (Result && !BsonDecodeDocument(FeatureDoc, NULL, BsonFields_feature_entity, ARRAY_COUNT(BsonFields_feature_entity), BSON_ALL_FIELDS, FeatureEntity)) {
+        Cursor->Failed = 1;
+        Result = 0;
+    }
+
+    MetricsRecordDbCall(DB_CALL_DbFeaturesCursorNext, GetMonotonicTimeNs() - StartNs);
+    return Result;
+}
@@ -38,6 +38,15 @@ typedef struct {
 #undef X
 } user_entity;
 
+typedef enum {
+#define X(Type, Name) USER_FIELD_##Name,
+    DECLARE_USER_ENTITY
+#undef X
+    USER_FIELDS_COUNT,
+} user_field;
+
+#define USER_ALL_FIELDS (((u64)1 << USER_FIELDS_COUNT) - 1)
+
 typedef enum {
     PRIORITY_LOW,
     PRIORITY_MEDIUM,
@@ -68,24 +77,129 @@ typedef struct {
 
 void DbInit(void);
 
-b32 DbInsertProject(const project_entity *);
+// NOTE(oleh): Every database call takes a client from a pool of at most `MaxSize` of them.
+// An exhaustion is a call that found the pool empty and had to wait, `WaitNs` is the time
+// spent waiting by all of those together.
+typedef struct {
+    u64 Acquisitions;
+    u64 Exhaustions;
+    u64 WaitNs;
+    u64 MaxWaitNs;
+    u32 InUse;
+    u32 MaxSize;
+} db_pool_stats;
+
+db_pool_stats DbGetPoolStats(void);
+
+// NOTE(oleh): The calls whose latency goes into the metrics, pool waits included.
+#define ENUM_DB_CALLS                           \
+    X(DbInsertProject)                          \
+    X(DbGetProjectById)                         \
+    X(DbGetProjectByName)                       \
+    X(DbGetProjectsByIds)                       \
+    X(DbUpdateProject)                          \
+    X(DbDeleteProjectById)                      \
+    X(DbProjectsCursorOpen)                     \
+    X(DbProjectsCursorNext)                     \
+    X(DbCursorClose)                            \
+    X(DbInsertUser)                             \
+    X(DbGetUserByLogin)                         \
+    X(DbGetUsersByIds)                          \
+    X(DbInsertFeature)                          \
+    X(DbGetFeatureById)                         \
+    X(DbUpdateFeature)                          \
+    X(DbDeleteFeatureById)                      \
+    X(DbProjectFeaturesCursorOpen)              \
+    X(DbFeaturesCursorNext)
+
+typedef enum {
+#define X(Name) DB_CALL_##Name,
+    ENUM_DB_CALLS
+#undef X
+    DB_CALLS_COUNT,
+} db_call;
+
+// NOTE(oleh): Ids are unique in every collection and so are user logins. An insert that repeats
+// an Id fails with `DB_INSERT_DUPLICATE_ID`, one that repeats any other unique key with
+// `DB_INSERT_DUPLICATE`, so generated Ids can be retried without hiding a real conflict.
+typedef enum {
+    DB_INSERT_OK,
+    DB_INSERT_DUPLICATE,
+    DB_INSERT_DUPLICATE_ID,
+    DB_INSERT_FAILED,
+} db_insert_result;
+
+// NOTE(oleh): Writes to a single document by its Id tell a missing document apart from a failure.
+typedef enum {
+    DB_WRITE_OK,
+    DB_WRITE_NOT_FOUND,
+    DB_WRITE_FAILED,
+} db_write_result;
+
+db_insert_result DbInsertProject(const project_entity *);
 b32 DbGetProjectById(arena *, string_view, project_entity *);
+b32 DbGetProjectByName(arena *, string_view, project_entity *);
+
+// NOTE(oleh): Looks up every Id in a single query. The entity for `Ids[I]` goes into `Out[I]` and
+// `Found[I]` tells whether there was one, the same Id may show up more than once. Only the fields
+// in the mask are filled, as with `db_projects_page`.
+b32 DbGetProjectsByIds(arena *, const string_view *Ids, uz IdsCount, u64 Fields, project_entity *Out, b32 *Found);
 b32 DbUpdateProject(const project_update_entity *);
 b32 DbDeleteProjectById(string_view);
 
-b32 DbGetAllProjects(arena *, project_entity **, uz *);
+// NOTE(oleh): Walks a collection one document at a time. Entities returned by `Next` point into
+// the current document and are only valid until the following call. `Close` returns 0 if the
+// iteration stopped because of an error rather than the end of the results.
+typedef struct {
+    void *Handle;
+    void *Client;
+    void *Collection;
+    u64 Fields;
+    b32 Failed;
+} db_cursor;
+
+typedef enum {
+#define X(Type, Name) PROJECT_FIELD_##Name,
+    DECLARE_PROJECT_ENTITY
+#undef X
+    PROJECT_FIELDS_COUNT,
+} project_field;
+
+#define PROJECT_ALL_FIELDS (((u64)1 << PROJECT_FIELDS_COUNT) - 1)
+
+// NOTE(oleh): Projects come ordered by Id. A page starts right after the `After` Id, or at the
+// beginning if it is empty, and has at most `Limit` projects, all of them if it is 0. `Fields` has
+// a `1 << PROJECT_FIELD_*` bit for each field to fetch, the others are left as they are.
+typedef struct {
+    string_view After;
+    u32 Limit;
+    u64 Fields;
+} db_projects_page;
+
+b32 DbProjectsCursorOpen(db_cursor *, const db_projects_page *);
+b32 DbProjectsCursorNext(db_cursor *, project_entity *);
+b32 DbCursorClose(db_cursor *);
 
-b32 DbInsertUser(const user_entity *);
+db_insert_result DbInsertUser(const user_entity *);
 b32 DbGetUserById(string_view, user_entity *);
 b32 DbGetUserByLogin(arena *Arena, string_view FirstName, string_view LastName, user_entity *User);
+b32 DbGetUsersByIds(arena *, const string_view *Ids, uz IdsCount, u64 Fields, user_entity *Out, b32 *Found);
 b32 DbUpdateUser(user_entity * /* TODO(oleh): Additional arguments. */);
 b32 DbDeleteUser(user_entity *);
 
-b32 DbInsertFeature(const feature_entity *);
-b32 DbGetFeatureById(string_view, feature_entity *);
-b32 DbUpdateFeature(feature_entity * /* TODO(oleh): Additional arguments. */);
-b32 DbDeleteFeature(feature_entity *);
+db_insert_result DbInsertFeature(const feature_entity *);
+b32 DbGetFeatureById(arena *, string_view, feature_entity *);
+// NOTE(oleh): Replaces the whole feature with the same Id.
+db_write_result DbUpdateFeature(const feature_entity *);
+db_write_result DbDeleteFeatureById(string_view);
+
+// NOTE(oleh): Features of one project ordered by state, then priority, then Id. Without `After`
+// they start at the beginning, otherwise right after it, only its State, Priority and Id are
+// looked at. At most `Limit` of them, all if it is 0.
+b32 DbProjectFeaturesCursorOpen(db_cursor *, string_view ProjectId, const feature_entity *After, u32 Limit);
+b32 DbFeaturesCursorNext(db_cursor *, feature_entity *);
 
+// NOTE(oleh): The Id is 16 hex digits from the system random source.
 user_entity CreateUserWithRandomId(arena *Arena,
                                    string_view FirstName,
                                    string_view LastName,
@@ -1,156 +1,1317 @@
 #include "http.h"
+#include "scan.h"
+#include "metrics.h"
 
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
 #include <netdb.h>
 
 #include <errno.h>
+#include <time.h>
 
-b32 HttpRequestParse(arena *Arena, string_view Buffer, http_request *OutRequest) {
-    printf("Parsing HTTP request (%zu bytes):\n" SV_FMT "\n", Buffer.Count, SV_ARG(Buffer));
+void HttpRequestParserInit(http_request_parser *Parser, uz MaxRequestSize) {
+    STRUCT_ZERO(Parser);
+    Parser->State = HTTP_PARSE_METHOD;
+    Parser->MaxRequestSize = MaxRequestSize;
+    Parser->ErrorStatus = HTTP_STATUS_BAD_REQUEST;
+}
+
+static inline uz HttpFindByte(string_view Buffer, uz Start, u8 Byte) {
+    return Start + ScanFindByte(Buffer.Items + Start, Buffer.Count - Start, Byte);
+}
+
+static inline uz HttpFindByte2(string_view Buffer, uz Start, u8 First, u8 Second) {
+    return Start + ScanFindByte2(Buffer.Items + Start, Buffer.Count - Start, First, Second);
+}
+
+static inline b32 HttpIsOptionalWhitespace(u8 Char) {
+    return Char == ' ' || Char == '\t';
+}
+
+static inline s32 HttpHexDigitValue(u8 Char) {
+    if (Char >= '0' && Char <= '9') return Char - '0';
+    if (Char >= 'a' && Char <= 'f') return Char - 'a' + 10;
+    if (Char >= 'A' && Char <= 'F') return Char - 'A' + 10;
+    return -1;
+}
 
-    // 1. Request line. (https://datatracker.ietf.org/doc/html/rfc2616#section-5.1)
-    // 1.1. Method. (https://datatracker.ietf.org/doc/html/rfc2616#section-5.1.1)
+static b32 HttpParseContentLength(string_view Value, uz *OutLength) {
+    if (Value.Count == 0 || Value.Count > 18) return 0;
+
+    uz Length = 0;
+    for (uz I = 0; I < Value.Count; ++I) {
+        u8 Char = Value.Items[I];
+        if (Char < '0' || Char > '9') return 0;
+        Length = Length * 10 + (Char - '0');
+    }
+
+    *OutLength = Length;
+    return 1;
+}
+
+static inline string_view HttpParserSlice(string_view Buffer, uz Start, uz Count) {
+    return (string_view) {.Items = Buffer.Items + Start, .Count = Count};
+}
+
+static http_parse_result HttpParserFail(http_request_parser *Parser, http_response_status Status) {
+    Parser->ErrorStatus = Status;
+    return HTTP_PARSE_ERROR;
+}
 
-    uz I;
-    for (I = 0; I < Buffer.Count; ++I) {
-        if (Buffer.Items[I] == ' ') break;
+// NOTE(oleh): Called once the empty line after the headers was consumed. Decides how the
+// message body is delimited. (https://datatracker.ietf.org/doc/html/rfc2616#section-4.4)
+static http_parse_result HttpParserBeginBody(http_request_parser *Parser, string_view Buffer) {
+    b32 Chunked = 0;
+    b32 HasContentLength = 0;
+    uz ContentLength = 0;
+
+    for (uz HeaderIndex = 0; HeaderIndex < Parser->HeadersCount; ++HeaderIndex) {
+        http_parser_header *Header = &Parser->Headers[HeaderIndex];
+        string_view Name = HttpParserSlice(Buffer, Header->NameStart, Header->NameCount);
+        string_view Value = HttpParserSlice(Buffer, Header->ValueStart, Header->ValueCount);
+
+        if (StringViewEqualIgnoreCaseCStr(Name, "Transfer-Encoding")) {
+            // FIXME(oleh): Only a sole "chunked" coding is understood.
+            if (!StringViewEqualIgnoreCaseCStr(Value, "chunked")) return HttpParserFail(Parser, HTTP_STATUS_BAD_REQUEST);
+            Chunked = 1;
+        } else if (StringViewEqualIgnoreCaseCStr(Name, "Content-Length")) {
+            uz Length;
+            if (!HttpParseContentLength(Value, &Length)) return HttpParserFail(Parser, HTTP_STATUS_BAD_REQUEST);
+            if (HasContentLength && Length != ContentLength) return HttpParserFail(Parser, HTTP_STATUS_BAD_REQUEST);
+            HasContentLength = 1;
+            ContentLength = Length;
+        }
     }
 
-    if (I >= Buffer.Count) return 0;
+    Parser->BodyStart = Parser->Position;
+    Parser->BodyEnd = Parser->Position;
+
+    if (Chunked) {
+        // NOTE(oleh): Both at once is a request smuggling attempt.
+        if (HasContentLength) return HttpParserFail(Parser, HTTP_STATUS_BAD_REQUEST);
+        Parser->State = HTTP_PARSE_CHUNK_SIZE;
+        Parser->BodyRemaining = 0;
+        return HTTP_PARSE_INCOMPLETE;
+    }
 
-    http_method RequestMethod;
-    string_view RequestMethodSv = {.Items = Buffer.Items, .Count = I};
-#define X(Method) if (StringViewEqualCStr(RequestMethodSv, #Method)) {  \
-        RequestMethod = HTTP_##Method;                                  \
-        goto RequestMethodSuccess;                                      \
+    if (ContentLength > Parser->MaxRequestSize || Parser->Position + ContentLength > Parser->MaxRequestSize) {
+        return HttpParserFail(Parser, HTTP_STATUS_PAYLOAD_TOO_LARGE);
     }
 
-    ENUM_HTTP_METHODS
+    Parser->BodyRemaining = ContentLength;
+    Parser->State = ContentLength == 0 ? HTTP_PARSE_DONE : HTTP_PARSE_BODY;
+    return HTTP_PARSE_INCOMPLETE;
+}
+
+http_parse_result HttpRequestParserFeed(http_request_parser *Parser, arena *Arena, string_view Buffer, http_request *Out) {
+    while (Parser->State != HTTP_PARSE_DONE) {
+        if (Parser->Position >= Buffer.Count) return HTTP_PARSE_INCOMPLETE;
+
+        switch (Parser->State) {
+        // 1. Request line. (https://datatracker.ietf.org/doc/html/rfc2616#section-5.1)
+        // 1.1. Method. (https://datatracker.ietf.org/doc/html/rfc2616#section-5.1.1)
+        case HTTP_PARSE_METHOD: {
+            uz End = HttpFindByte(Buffer, Parser->Position, ' ');
+            if (End - Parser->TokenStart > 16) return HttpParserFail(Parser, HTTP_STATUS_BAD_REQUEST);
+
+            Parser->Position = End;
+            if (End >= Buffer.Count) return HTTP_PARSE_INCOMPLETE;
+
+            string_view RequestMethodSv = HttpParserSlice(Buffer, Parser->TokenStart, End - Parser->TokenStart);
+#define X(MethodName) if (StringViewEqualCStr(RequestMethodSv, #MethodName)) { \
+                Parser->Method = HTTP_##MethodName;                     \
+                goto RequestMethodSuccess;                              \
+            }
+
+            ENUM_HTTP_METHODS
 
 #undef X
 
-    // Failed to parse the HTTP method.
-    return 0;
+            // NOTE(oleh): Failed to parse the HTTP method.
+            return HttpParserFail(Parser, HTTP_STATUS_BAD_REQUEST);
+
+        RequestMethodSuccess:
+            Parser->Position = End + 1;
+            Parser->TokenStart = Parser->Position;
+            Parser->State = HTTP_PARSE_PATH;
+        } break;
+        // 1.2. Request URI. (https://datatracker.ietf.org/doc/html/rfc2616#section-5.1.2)
+        // FIXME(oleh): Actually parse URI's.
+        case HTTP_PARSE_PATH: {
+            uz End = HttpFindByte2(Buffer, Parser->Position, ' ', '\r');
+
+            Parser->Position = End;
+            if (End >= Buffer.Count) return HTTP_PARSE_INCOMPLETE;
+            if (Buffer.Items[End] != ' ' || End == Parser->TokenStart) return HttpParserFail(Parser, HTTP_STATUS_BAD_REQUEST);
+
+            Parser->PathStart = Parser->TokenStart;
+            Parser->PathCount = End - Parser->TokenStart;
+
+            Parser->Position = End + 1;
+            Parser->TokenStart = Parser->Position;
+            Parser->State = HTTP_PARSE_VERSION;
+        } break;
+        // 1.3. HTTP version.
+        case HTTP_PARSE_VERSION: {
+            uz End = HttpFindByte(Buffer, Parser->Position, '\r');
+            if (End - Parser->TokenStart > 16) return HttpParserFail(Parser, HTTP_STATUS_BAD_REQUEST);
+
+            Parser->Position = End;
+            if (End >= Buffer.Count) return HTTP_PARSE_INCOMPLETE;
+
+            string_view VersionSv = HttpParserSlice(Buffer, Parser->TokenStart, End - Parser->TokenStart);
+
+#define X(VersionName, String) if (StringViewEqualCStr(VersionSv, String)) { \
+                Parser->Version = HTTP_##VersionName;                   \
+                goto RequestVersionSuccess;                             \
+            }
+
+            ENUM_HTTP_VERSIONS
+#undef X
 
- RequestMethodSuccess:
-    // 1.2. Request URI. (https://datatracker.ietf.org/doc/html/rfc2616#section-5.1.2)
-    // FIXME(oleh): Actually parse URI's.
+            // NOTE(oleh): Failed to recognize the HTTP version.
+            return HttpParserFail(Parser, HTTP_STATUS_BAD_REQUEST);
+
+        RequestVersionSuccess:
+            Parser->Position = End + 1;
+            Parser->State = HTTP_PARSE_REQUEST_LINE_LF;
+        } break;
+        // 1.4. CRLF.
+        case HTTP_PARSE_REQUEST_LINE_LF: {
+            if (Buffer.Items[Parser->Position] != '\n') return HttpParserFail(Parser, HTTP_STATUS_BAD_REQUEST);
+            ++Parser->Position;
+            Parser->State = HTTP_PARSE_HEADER_LINE_START;
+        } break;
+        // 2. Headers. (https://datatracker.ietf.org/doc/html/rfc2616#section-5.3)
+        case HTTP_PARSE_HEADER_LINE_START: {
+            if (Buffer.Items[Parser->Position] == '\r') {
+                ++Parser->Position;
+                Parser->State = HTTP_PARSE_HEADERS_END_LF;
+                break;
+            }
+
+            if (Parser->HeadersCount >= HTTP_MAX_HEADERS) return HttpParserFail(Parser, HTTP_STATUS_BAD_REQUEST);
+
+            Parser->TokenStart = Parser->Position;
+            Parser->State = HTTP_PARSE_HEADER_NAME;
+        } break;
+        case HTTP_PARSE_HEADER_NAME: {
+            uz End = HttpFindByte2(Buffer, Parser->Position, ':', '\r');
+
+            Parser->Position = End;
+            if (End >= Buffer.Count) return HTTP_PARSE_INCOMPLETE;
+            if (Buffer.Items[End] != ':' || End == Parser->TokenStart) return HttpParserFail(Parser, HTTP_STATUS_BAD_REQUEST);
+
+            http_parser_header *Header = &Parser->Headers[Parser->HeadersCount];
+            Header->NameStart = Parser->TokenStart;
+            Header->NameCount = End - Parser->TokenStart;
+
+            Parser->Position = End + 1;
+            Parser->TokenStart = Parser->Position;
+            Parser->State = HTTP_PARSE_HEADER_VALUE;
+        } break;
+        case HTTP_PARSE_HEADER_VALUE: {
+            uz End = HttpFindByte(Buffer, Parser->Position, '\r');
+
+            Parser->Position = End;
+            if (End >= Buffer.Count) return HTTP_PARSE_INCOMPLETE;
+
+            // NOTE(oleh): Strip the optional whitespace around the field value.
+            uz ValueStart = Parser->TokenStart;
+            uz ValueEnd = End;
+            while (ValueStart < ValueEnd && HttpIsOptionalWhitespace(Buffer.Items[ValueStart])) ++ValueStart;
+            while (ValueEnd > ValueStart && HttpIsOptionalWhitespace(Buffer.Items[ValueEnd - 1])) --ValueEnd;
+
+            http_parser_header *Header = &Parser->Headers[Parser->HeadersCount];
+            Header->ValueStart = ValueStart;
+            Header->ValueCount = ValueEnd - ValueStart;
+            ++Parser->HeadersCount;
+
+            Parser->Position = End + 1;
+            Parser->State = HTTP_PARSE_HEADER_LINE_LF;
+        } break;
+        case HTTP_PARSE_HEADER_LINE_LF: {
+            if (Buffer.Items[Parser->Position] != '\n') return HttpParserFail(Parser, HTTP_STATUS_BAD_REQUEST);
+            ++Parser->Position;
+            Parser->State = HTTP_PARSE_HEADER_LINE_START;
+        } break;
+        case HTTP_PARSE_HEADERS_END_LF: {
+            if (Buffer.Items[Parser->Position] != '\n') return HttpParserFail(Parser, HTTP_STATUS_BAD_REQUEST);
+            ++Parser->Position;
+            if (HttpParserBeginBody(Parser, Buffer) == HTTP_PARSE_ERROR) return HTTP_PARSE_ERROR;
+        } break;
+        // 3. Message body. (https://datatracker.ietf.org/doc/html/rfc2616#section-4.3)
+        case HTTP_PARSE_BODY: {
+            uz AvailableBytes = Buffer.Count - Parser->Position;
+            uz TakenBytes = AvailableBytes < Parser->BodyRemaining ? AvailableBytes : Parser->BodyRemaining;
+
+            Parser->Position += TakenBytes;
+            Parser->BodyEnd += TakenBytes;
+            Parser->BodyRemaining -= TakenBytes;
+
+            if (Parser->BodyRemaining == 0) Parser->State = HTTP_PARSE_DONE;
+        } break;
+        // 3.1. Chunked transfer coding. (https://datatracker.ietf.org/doc/html/rfc2616#section-3.6.1)
+        case HTTP_PARSE_CHUNK_SIZE: {
+            u8 Char = Buffer.Items[Parser->Position];
+
+            if (Char == '\r' || Char == ';') {
+                Parser->State = Char == ';' ? HTTP_PARSE_CHUNK_EXTENSION : HTTP_PARSE_CHUNK_SIZE_LF;
+                ++Parser->Position;
+                break;
+            }
+
+            s32 Digit = HttpHexDigitValue(Char);
+            if (Digit < 0) return HttpParserFail(Parser, HTTP_STATUS_BAD_REQUEST);
+
+            Parser->BodyRemaining = Parser->BodyRemaining * 16 + Digit;
+            if (Parser->BodyRemaining > Parser->MaxRequestSize) return HttpParserFail(Parser, HTTP_STATUS_PAYLOAD_TOO_LARGE);
+
+            ++Parser->Position;
+        } break;
+        case HTTP_PARSE_CHUNK_EXTENSION: {
+            // NOTE(oleh): Chunk extensions are ignored.
+            uz End = HttpFindByte(Buffer, Parser->Position, '\r');
+
+            Parser->Position = End;
+            if (End >= Buffer.Count) return HTTP_PARSE_INCOMPLETE;
+
+            Parser->Position = End + 1;
+            Parser->State = HTTP_PARSE_CHUNK_SIZE_LF;
+        } break;
+        case HTTP_PARSE_CHUNK_SIZE_LF: {
+            if (Buffer.Items[Parser->Position] != '\n') return HttpParserFail(Parser, HTTP_STATUS_BAD_REQUEST);
+            ++Parser->Position;
+
+            if (Parser->BodyRemaining == 0) {
+                Parser->State = HTTP_PARSE_TRAILER_LINE_START;
+            } else {
+                if (Parser->BodyEnd - Parser->BodyStart + Parser->BodyRemaining > Parser->MaxRequestSize) {
+                    return HttpParserFail(Parser, HTTP_STATUS_PAYLOAD_TOO_LARGE);
+                }
+                Parser->State = HTTP_PARSE_CHUNK_DATA;
+            }
+        } break;
+        case HTTP_PARSE_CHUNK_DATA: {
+            uz AvailableBytes = Buffer.Count - Parser->Position;
+            uz TakenBytes = AvailableBytes < Parser->BodyRemaining ? AvailableBytes : Parser->BodyRemaining;
+
+            if (Parser->BodyEnd != Parser->Position) {
+                memmove(Buffer.Items + Parser->BodyEnd, Buffer.Items + Parser->Position, TakenBytes);
+            }
+
+            Parser->Position += TakenBytes;
+            Parser->BodyEnd += TakenBytes;
+            Parser->BodyRemaining -= TakenBytes;
+
+            if (Parser->BodyRemaining == 0) Parser->State = HTTP_PARSE_CHUNK_DATA_CR;
+        } break;
+        case HTTP_PARSE_CHUNK_DATA_CR: {
+            if (Buffer.Items[Parser->Position] != '\r') return HttpParserFail(Parser, HTTP_STATUS_BAD_REQUEST);
+            ++Parser->Position;
+            Parser->State = HTTP_PARSE_CHUNK_DATA_LF;
+        } break;
+        case HTTP_PARSE_CHUNK_DATA_LF: {
+            if (Buffer.Items[Parser->Position] != '\n') return HttpParserFail(Parser, HTTP_STATUS_BAD_REQUEST);
+            ++Parser->Position;
+            Parser->State = HTTP_PARSE_CHUNK_SIZE;
+        } break;
+        // NOTE(oleh): Trailer fields are skipped.
+        case HTTP_PARSE_TRAILER_LINE_START: {
+            if (Buffer.Items[Parser->Position] == '\r') {
+                ++Parser->Position;
+                Parser->State = HTTP_PARSE_TRAILER_END_LF;
+            } else {
+                Parser->State = HTTP_PARSE_TRAILER_LINE;
+            }
+        } break;
+        case HTTP_PARSE_TRAILER_LINE: {
+            uz End = HttpFindByte(Buffer, Parser->Position, '\n');
+
+            Parser->Position = End;
+            if (End >= Buffer.Count) return HTTP_PARSE_INCOMPLETE;
+
+            Parser->Position = End + 1;
+            Parser->State = HTTP_PARSE_TRAILER_LINE_START;
+        } break;
+        case HTTP_PARSE_TRAILER_END_LF: {
+            if (Buffer.Items[Parser->Position] != '\n') return HttpParserFail(Parser, HTTP_STATUS_BAD_REQUEST);
+            ++Parser->Position;
+            Parser->State = HTTP_PARSE_DONE;
+        } break;
+        case HTTP_PARSE_DONE: UNREACHABLE();
+        }
+    }
 
-    uz PathStart = I + 1;
+    http_header *RequestHeadersItems = ArenaPush(Arena, sizeof(http_header) * (Parser->HeadersCount + 1));
 
-    for (I = PathStart; I < Buffer.Count; ++I) {
-        if (Buffer.Items[I] == ' ') break;
+    for (uz HeaderIndex = 0; HeaderIndex < Parser->HeadersCount; ++HeaderIndex) {
+        http_parser_header *Header = &Parser->Headers[HeaderIndex];
+        RequestHeadersItems[HeaderIndex] = (http_header) {
+            .Name = HttpParserSlice(Buffer, Header->NameStart, Header->NameCount),
+            .Value = HttpParserSlice(Buffer, Header->ValueStart, Header->ValueCount),
+        };
     }
 
-    if (I >= Buffer.Count) return 0;
+    string_view Target = HttpParserSlice(Buffer, Parser->PathStart, Parser->PathCount);
+    uz QueryStart = ScanFindByte(Target.Items, Target.Count, '?');
+
+    Out->Method = Parser->Method;
+    Out->Path = (string_view) {.Items = Target.Items, .Count = QueryStart};
+    Out->Query = QueryStart < Target.Count
+        ? (string_view) {.Items = Target.Items + QueryStart + 1, .Count = Target.Count - QueryStart - 1}
+        : (string_view) {.Items = Target.Items + Target.Count, .Count = 0};
+    Out->Params = (http_path_params) {0};
+    Out->Version = Parser->Version;
+    Out->Headers.Items = RequestHeadersItems;
+    Out->Headers.Count = Parser->HeadersCount;
+    Out->Body = HttpParserSlice(Buffer, Parser->BodyStart, Parser->BodyEnd - Parser->BodyStart);
+
+    return HTTP_PARSE_COMPLETE;
+}
 
-    string_view RequestPath = {.Items = Buffer.Items + PathStart, .Count = I - PathStart};
+b32 HttpRequestGetHeader(const http_request *Request, const char *Name, string_view *OutValue) {
+    for (uz HeaderIndex = 0; HeaderIndex < Request->Headers.Count; ++HeaderIndex) {
+        http_header Header = Request->Headers.Items[HeaderIndex];
+        if (!StringViewEqualIgnoreCaseCStr(Header.Name, Name)) continue;
 
-    // 1.3. HTTP version.
+        *OutValue = Header.Value;
+        return 1;
+    }
+
+    return 0;
+}
 
-    uz VersionStart = I + 1;
+b32 HttpRequestGetParam(const http_request *Request, const char *Name, string_view *OutValue) {
+    for (uz ParamIndex = 0; ParamIndex < Request->Params.Count; ++ParamIndex) {
+        http_path_param Param = Request->Params.Items[ParamIndex];
+        if (!StringViewEqualCStr(Param.Name, Name)) continue;
 
-    for (I = VersionStart; I < Buffer.Count; ++I) {
-        if (Buffer.Items[I] == '\r') break;
+        *OutValue = Param.Value;
+        return 1;
     }
 
-    if (I >= Buffer.Count) return 0;
+    return 0;
+}
 
-    http_version RequestVersion;
-    string_view VersionSv = {.Items = Buffer.Items + VersionStart, .Count = I - VersionStart};
+// NOTE(oleh): A '%' that is not followed by two hex digits is kept as is.
+static string_view HttpPercentDecode(arena *Arena, string_view Value) {
+    uz EscapeIndex = ScanFindByte2(Value.Items, Value.Count, '%', '+');
+    if (EscapeIndex == Value.Count) return Value;
+
+    u8 *Decoded = ArenaPush(Arena, Value.Count);
+    memcpy(Decoded, Value.Items, EscapeIndex);
+    uz DecodedCount = EscapeIndex;
+
+    for (uz Index = EscapeIndex; Index < Value.Count; ++Index) {
+        u8 Char = Value.Items[Index];
+
+        if (Char == '+') {
+            Char = ' ';
+        } else if (Char == '%' && Index + 2 < Value.Count) {
+            s32 High = HttpHexDigitValue(Value.Items[Index + 1]);
+            s32 Low = HttpHexDigitValue(Value.Items[Index + 2]);
+            if (High >= 0 && Low >= 0) {
+                Char = (u8)(High * 16 + Low);
+                Index += 2;
+            }
+        }
 
-#define X(Version, String) if (StringViewEqualCStr(VersionSv, String)) { \
-        RequestVersion = HTTP_##Version;                                \
-        goto RequestVersionSuccess;                                     \
+        Decoded[DecodedCount++] = Char;
     }
 
-    ENUM_HTTP_VERSIONS
-#undef X
+    return (string_view) {.Items = Decoded, .Count = DecodedCount};
+}
+
+b32 HttpRequestGetQueryParam(arena *Arena, const http_request *Request, const char *Name, string_view *OutValue) {
+    string_view Rest = Request->Query;
+
+    while (Rest.Count > 0) {
+        uz PairEnd = ScanFindByte(Rest.Items, Rest.Count, '&');
+        string_view Pair = {.Items = Rest.Items, .Count = PairEnd};
+
+        uz Consumed = PairEnd < Rest.Count ? PairEnd + 1 : PairEnd;
+        Rest.Items += Consumed;
+        Rest.Count -= Consumed;
+
+        uz KeyEnd = ScanFindByte(Pair.Items, Pair.Count, '=');
+        string_view Key = HttpPercentDecode(Arena, (string_view) {.Items = Pair.Items, .Count = KeyEnd});
+        if (!StringViewEqualCStr(Key, Name)) continue;
+
+        string_view Value = KeyEnd < Pair.Count
+            ? (string_view) {.Items = Pair.Items + KeyEnd + 1, .Count = Pair.Count - KeyEnd - 1}
+            : (string_view) {.Items = Pair.Items + Pair.Count, .Count = 0};
+
+        *OutValue = HttpPercentDecode(Arena, Value);
+        return 1;
+    }
 
-    // NOTE(oleh): Failed to recognize the HTTP version.
     return 0;
- RequestVersionSuccess:
-    // 1.4. CRLF.
+}
 
-    if (Buffer.Count - I <= 1) return 0;
-    if (Buffer.Items[I + 1] != '\n') return 0;
+b32 HttpRequestMatchesETag(const http_request *Request, string_view ETag) {
+    string_view IfNoneMatch;
+    if (!HttpRequestGetHeader(Request, "If-None-Match", &IfNoneMatch)) return 0;
 
-    Buffer.Items += I + 2;
-    Buffer.Count -= I + 2;
+    uz Position = 0;
+    while (Position < IfNoneMatch.Count) {
+        uz TagEnd = HttpFindByte(IfNoneMatch, Position, ',');
 
-    // 2. Headers. (https://datatracker.ietf.org/doc/html/rfc2616#section-5.3)
-    // FIXME(oleh): Actually parse the headers according to their specification.
+        uz TagStart = Position;
+        while (TagStart < TagEnd && HttpIsOptionalWhitespace(IfNoneMatch.Items[TagStart])) ++TagStart;
 
-    http_header *RequestHeadersItems = ARENA_NEW(Arena, http_header);
-    uz RequestHeadersCount = 0;
+        uz TagCount = TagEnd - TagStart;
+        while (TagCount != 0 && HttpIsOptionalWhitespace(IfNoneMatch.Items[TagStart + TagCount - 1])) --TagCount;
 
-    for (I = 0; I < Buffer.Count; ++I) {
-        if (Buffer.Items[I] == '\r' && Buffer.Count - I > 1 && Buffer.Items[I + 1] == '\n') break;
+        string_view Tag = {.Items = IfNoneMatch.Items + TagStart, .Count = TagCount};
 
-        uz HeaderNameStart = I;
+        // NOTE(oleh): If-None-Match uses the weak comparison, the W/ prefix does not matter.
+        if (Tag.Count >= 2 && Tag.Items[0] == 'W' && Tag.Items[1] == '/') {
+            Tag.Items += 2;
+            Tag.Count -= 2;
+        }
+
+        if (StringViewEqualCStr(Tag, "*") || StringViewEqual(Tag, ETag)) return 1;
+
+        Position = TagEnd + 1;
+    }
 
-        for (; I < Buffer.Count; ++I) {
-            if (Buffer.Items[I] == ':') break;
+    return 0;
+}
+
+// NOTE(oleh): Routes are kept in a radix tree. Static edges are compressed prefixes that
+// start with distinct bytes, and every node has at most one parameter edge which swallows
+// a single non-empty path segment. Lookups prefer static edges and only fall back to the
+// parameter edge, so the work done is proportional to the length of the path.
+struct http_route_node {
+    string_view Prefix;
+    string_view ParamName;
+
+    http_route_node *Children;
+    http_route_node *NextSibling;
+    http_route_node *ParamChild;
+
+    http_request_handler Handlers[HTTP_METHODS_COUNT];
+    u32 MetricsRoutes[HTTP_METHODS_COUNT];
+    b32 HasHandlers;
+};
+
+static uz CommonPrefixLength(string_view Lhs, string_view Rhs) {
+    uz Length = 0;
+    while (Length < Lhs.Count && Length < Rhs.Count && Lhs.Items[Length] == Rhs.Items[Length]) ++Length;
+    return Length;
+}
+
+static void HttpRouteInsert(arena *Arena, http_route_node *Node, const char *Path, http_method Method, http_request_handler Handler) {
+    string_view Rest = SV_LIT(Path);
+
+    while (Rest.Count != 0) {
+        if (Rest.Items[0] == ':') {
+            uz NameEnd = ScanFindByte(Rest.Items, Rest.Count, '/');
+            string_view ParamName = {.Items = Rest.Items + 1, .Count = NameEnd - 1};
+            if (ParamName.Count == 0) PANIC("Path parameters must have a name");
+
+            if (Node->ParamChild == NULL) {
+                Node->ParamChild = ARENA_NEW(Arena, http_route_node);
+                Node->ParamChild->ParamName = ParamName;
+            } else if (!StringViewEqual(Node->ParamChild->ParamName, ParamName)) {
+                PANIC_FMT("Conflicting path parameters ':" SV_FMT "' and ':" SV_FMT "'",
+                          SV_ARG(Node->ParamChild->ParamName), SV_ARG(ParamName));
+            }
+
+            Node = Node->ParamChild;
+            Rest.Items += NameEnd;
+            Rest.Count -= NameEnd;
+            continue;
         }
 
-        if (I >= Buffer.Count) return 0;
+        uz StaticEnd = ScanFindByte(Rest.Items, Rest.Count, ':');
+        if (StaticEnd < Rest.Count && Rest.Items[StaticEnd - 1] != '/') {
+            PANIC_FMT("Path parameters have to span a whole segment, got '" SV_FMT "'", SV_ARG(Rest));
+        }
+
+        string_view Static = {.Items = Rest.Items, .Count = StaticEnd};
+
+        http_route_node **Link = &Node->Children;
+        while (*Link != NULL && (*Link)->Prefix.Items[0] != Static.Items[0]) Link = &(*Link)->NextSibling;
+
+        http_route_node *Child = *Link;
+        if (Child == NULL) {
+            Child = ARENA_NEW(Arena, http_route_node);
+            Child->Prefix = Static;
+            *Link = Child;
+
+            Node = Child;
+            Rest.Items += Static.Count;
+            Rest.Count -= Static.Count;
+            continue;
+        }
+
+        uz MatchedLength = CommonPrefixLength(Child->Prefix, Static);
+
+        if (MatchedLength < Child->Prefix.Count) {
+            // NOTE(oleh): Split the edge, the existing child keeps the part that did not match.
+            http_route_node *Split = ARENA_NEW(Arena, http_route_node);
+            Split->Prefix = (string_view) {.Items = Child->Prefix.Items, .Count = MatchedLength};
+            Split->NextSibling = Child->NextSibling;
+            Split->Children = Child;
 
-        string_view HeaderName = {.Items = Buffer.Items + HeaderNameStart, .Count = I - HeaderNameStart};
+            Child->Prefix.Items += MatchedLength;
+            Child->Prefix.Count -= MatchedLength;
+            Child->NextSibling = NULL;
 
-        uz HeaderValueStart = I + 1;
+            *Link = Split;
+            Child = Split;
+        }
+
+        Node = Child;
+        Rest.Items += MatchedLength;
+        Rest.Count -= MatchedLength;
+    }
+
+    if (Node->Handlers[Method] != NULL) {
+        PANIC("A handler for this method and path is already attached");
+    }
 
-        for (I = HeaderValueStart; I < Buffer.Count; ++I) {
-            if (Buffer.Items[I] == '\r') break;
+    if (!Node->HasHandlers) {
+        for (uz RouteMethod = 0; RouteMethod < HTTP_METHODS_COUNT; ++RouteMethod) {
+            Node->MetricsRoutes[RouteMethod] = MetricsRegisterRoute(RouteMethod, Path);
         }
+    }
+
+    Node->Handlers[Method] = Handler;
+    Node->HasHandlers = 1;
+}
+
+#define HTTP_MAX_PATH_PARAMS 16
 
-        if (Buffer.Count - I <= 1) return 0;
-        if (Buffer.Items[I + 1] != '\n') return 0;
+typedef struct {
+    http_path_param Items[HTTP_MAX_PATH_PARAMS];
+    uz Count;
+} http_route_params;
 
-        string_view HeaderValue = {.Items = Buffer.Items + I + 2, .Count = I - HeaderValueStart - 2};
+static http_route_node *HttpRouteLookup(http_route_node *Node, string_view Rest, http_route_params *Params) {
+    if (Rest.Count == 0) return Node->HasHandlers ? Node : NULL;
 
-        RequestHeadersItems[RequestHeadersCount] = (http_header) {.Name = HeaderName, .Value = HeaderValue};
-        ArenaPush(Arena, sizeof(http_header));
-        ++RequestHeadersCount;
+    for (http_route_node *Child = Node->Children; Child != NULL; Child = Child->NextSibling) {
+        if (Child->Prefix.Items[0] != Rest.Items[0]) continue;
+        if (Child->Prefix.Count > Rest.Count) break;
+        if (memcmp(Child->Prefix.Items, Rest.Items, Child->Prefix.Count) != 0) break;
 
-        ++I;
+        string_view ChildRest = {.Items = Rest.Items + Child->Prefix.Count, .Count = Rest.Count - Child->Prefix.Count};
+        http_route_node *Found = HttpRouteLookup(Child, ChildRest, Params);
+        if (Found != NULL) return Found;
+        break;
     }
 
-    if (I >= Buffer.Count) return 0;
+    if (Node->ParamChild != NULL && Params->Count < HTTP_MAX_PATH_PARAMS) {
+        uz SegmentEnd = ScanFindByte(Rest.Items, Rest.Count, '/');
+        if (SegmentEnd == 0) return NULL;
 
-    // 3. Message body. (https://datatracker.ietf.org/doc/html/rfc2616#section-4.3)
-    string_view RequestBody = {.Items = Buffer.Items + I + 2, .Count = Buffer.Count - I - 2};
+        http_path_param *Param = &Params->Items[Params->Count++];
+        Param->Name = Node->ParamChild->ParamName;
+        Param->Value = (string_view) {.Items = Rest.Items, .Count = SegmentEnd};
 
-    OutRequest->Method = RequestMethod;
-    OutRequest->Path = RequestPath;
-    OutRequest->Version = RequestVersion;
-    OutRequest->Headers.Items = RequestHeadersItems;
-    OutRequest->Headers.Count = RequestHeadersCount;
-    OutRequest->Body = RequestBody;
+        string_view ChildRest = {.Items = Rest.Items + SegmentEnd, .Count = Rest.Count - SegmentEnd};
+        http_route_node *Found = HttpRouteLookup(Node->ParamChild, ChildRest, Params);
+        if (Found != NULL) return Found;
 
-    return 1;
+        --Params->Count;
+    }
+
+    return NULL;
 }
 
-static const char *GetHttpResponseStatusReasonPhrase(http_response_status Status) {
+static const string_view HttpVersionStrings[] = {
+#define X(Version, String) [HTTP_##Version] = {.Items = (u8 *)String, .Count = sizeof(String) - 1},
+    ENUM_HTTP_VERSIONS
+#undef X
+};
+
+// NOTE(oleh): Everything in a response head up to the Content-Length header only depends on the
+// status, so it lives in static memory and is handed to the kernel as is.
+#define HTTP_RESPONSE_COMMON_HEADERS "Access-Control-Allow-Origin: *\r\n"
+#define HTTP_RESPONSE_STATIC_HEAD(Code, Phrase) " " #Code " " Phrase "\r\n" HTTP_RESPONSE_COMMON_HEADERS
+
+static string_view GetHttpResponseStaticHead(http_response_status Status) {
     switch (Status) {
-#define X(Status, _Code, Phrase) case HTTP_STATUS_##Status: return Phrase;
+#define X(Status, Code, Phrase) case HTTP_STATUS_##Status: return (string_view) { \
+            .Items = (u8 *)HTTP_RESPONSE_STATIC_HEAD(Code, Phrase),     \
+            .Count = sizeof(HTTP_RESPONSE_STATIC_HEAD(Code, Phrase)) - 1, \
+        };
         ENUM_HTTP_RESPONSE_STATUSES
 #undef X
     default: UNREACHABLE();
     }
 }
 
-static const char *HttpVersionStrings[] = {
-#define X(Version, String) [HTTP_##Version] = String,
-    ENUM_HTTP_VERSIONS
-#undef X
+#define TCP_BACKLOG_SIZE 256
+
+#define HTTP_SERVER_MAX_EVENTS 256
+
+// NOTE(oleh): Every connection owns three arenas: one that receives the raw request bytes, one
+// that handlers allocate from and one for the chunks of a streamed body. All of them are reserved
+// up front and only touched on demand.
+#define HTTP_CONNECTION_READ_CAPACITY (64ll * 1024ll * 1024ll)
+#define HTTP_CONNECTION_ARENA_CAPACITY (256ll * 1024ll * 1024ll)
+#define HTTP_CONNECTION_STREAM_CAPACITY (64ll * 1024ll * 1024ll)
+
+#define HTTP_RECV_CHUNK_SIZE (64 * 1024)
+
+// NOTE(oleh): Connections that did not make any progress for this long are closed.
+#define HTTP_IDLE_TIMEOUT_MS (30 * 1000)
+#define HTTP_IDLE_SWEEP_INTERVAL_MS 1000
+
+#define HTTP_MAX_REQUESTS_PER_CONNECTION 1000
+
+// NOTE(oleh): Stop answering pipelined requests once this much output is waiting for the client.
+#define HTTP_MAX_QUEUED_OUTPUT (4ll * 1024ll * 1024ll)
+
+// NOTE(oleh): Stop producing a streamed body once this much of it is waiting for the client.
+#define HTTP_MAX_STREAM_BUFFERED (256ll * 1024ll)
+
+// NOTE(oleh): One piece of a queued response. Pieces point into static memory or into the
+// connection arenas and are only gathered together by the kernel.
+typedef struct http_output {
+    string_view Data;
+    struct http_output *Next;
+} http_output;
+
+// NOTE(oleh): The response whose body is being produced. Requests pipelined after it wait until
+// it is complete, the order of the responses is the order of the requests.
+typedef struct {
+    http_response_context *Context;
+    http_stream_producer Produce;
+    void *State;
+
+    u32 MetricsRoute;
+    uz RequestSize;
+    u64 OutputTotalBefore;
+    u64 StartNs;
+} http_stream;
+
+typedef struct http_finish_callback {
+    http_response_finish_callback Callback;
+    void *UserData;
+    struct http_finish_callback *Next;
+} http_finish_callback;
+
+struct http_connection {
+    http_worker *Worker;
+    int Sock;
+    arena ReadArena;
+    arena Arena;
+    // NOTE(oleh): Holds the chunks of a streamed body, it is reset every time the output runs dry.
+    arena StreamArena;
+
+    // NOTE(oleh): Offset of the first byte in the read arena that does not belong to an answered request.
+    uz ParseOffset;
+    uz RequestsCount;
+    b32 ReadClosed;
+    b32 CloseAfterOutput;
+    // NOTE(oleh): A streamed response could not be finished, the client can only learn about it by the connection closing.
+    b32 Aborted;
+
+    // NOTE(oleh): Responses are queued in the order the requests came in.
+    http_output *OutputHead;
+    http_output *OutputTail;
+    uz OutputSent;
+    uz OutputQueued;
+    // NOTE(oleh): Every byte ever queued, the difference around a request is the size of its response.
+    u64 OutputTotal;
+
+    http_stream Stream;
+    // NOTE(oleh): Run before the connection arena is reset, the nodes live in it.
+    http_finish_callback *FinishCallbacks;
+
+    http_request_parser Parser;
+
+    u64 LastActivityMs;
+    http_connection *Older;
+    http_connection *Newer;
+
+    http_connection *NextFree;
 };
 
-#define TCP_BACKLOG_SIZE 256
+static u64 GetMonotonicTimeMs(void) {
+    return GetMonotonicTimeNs() / 1000000;
+}
 
-#define DEFAULT_REQUEST_ARENA_CAPACITY (4ll * 1024ll * 1024ll * 1024ll)
+static void HttpWorkerUnlinkConnection(http_worker *Worker, http_connection *Connection) {
+    if (Connection->Older != NULL) Connection->Older->Newer = Connection->Newer;
+    else Worker->OldestConnection = Connection->Newer;
 
-void HttpServerStart(http_server *Server, u16 Port) {
+    if (Connection->Newer != NULL) Connection->Newer->Older = Connection->Older;
+    else Worker->NewestConnection = Connection->Older;
+
+    Connection->Older = NULL;
+    Connection->Newer = NULL;
+}
+
+static void HttpWorkerTouchConnection(http_worker *Worker, http_connection *Connection) {
+    Connection->LastActivityMs = GetMonotonicTimeMs();
+
+    if (Worker->NewestConnection == Connection) return;
+
+    if (Connection->Older != NULL || Connection->Newer != NULL || Worker->OldestConnection == Connection) {
+        HttpWorkerUnlinkConnection(Worker, Connection);
+    }
+
+    Connection->Older = Worker->NewestConnection;
+    Connection->Newer = NULL;
+
+    if (Worker->NewestConnection != NULL) Worker->NewestConnection->Newer = Connection;
+    else Worker->OldestConnection = Connection;
+
+    Worker->NewestConnection = Connection;
+}
+
+static http_connection *HttpConnectionOpen(http_worker *Worker, int Sock) {
+    http_connection *Connection = Worker->FreeConnections;
+    if (Connection != NULL) {
+        Worker->FreeConnections = Connection->NextFree;
+    } else {
+        Connection = ARENA_NEW(&Worker->Arena, http_connection);
+        ArenaInit(&Connection->ReadArena, HTTP_CONNECTION_READ_CAPACITY);
+        ArenaInit(&Connection->Arena, HTTP_CONNECTION_ARENA_CAPACITY);
+        ArenaInit(&Connection->StreamArena, HTTP_CONNECTION_STREAM_CAPACITY);
+    }
+
+    Connection->Worker = Worker;
+    Connection->Sock = Sock;
+    Connection->ParseOffset = 0;
+    Connection->RequestsCount = 0;
+    Connection->ReadClosed = 0;
+    Connection->CloseAfterOutput = 0;
+    Connection->Aborted = 0;
+    Connection->OutputHead = NULL;
+    Connection->OutputTail = NULL;
+    Connection->OutputSent = 0;
+    Connection->OutputQueued = 0;
+    Connection->OutputTotal = 0;
+    Connection->Stream = (http_stream) {0};
+    Connection->FinishCallbacks = NULL;
+    Connection->Older = NULL;
+    Connection->Newer = NULL;
+    Connection->NextFree = NULL;
+    ArenaReset(&Connection->ReadArena);
+    ArenaReset(&Connection->Arena);
+    ArenaReset(&Connection->StreamArena);
+    HttpRequestParserInit(&Connection->Parser, Connection->ReadArena.Capacity);
+
+    HttpWorkerTouchConnection(Worker, Connection);
+
+    return Connection;
+}
+
+static void HttpConnectionRunFinishCallbacks(http_connection *Connection) {
+    for (http_finish_callback *Finish = Connection->FinishCallbacks; Finish != NULL; Finish = Finish->Next) {
+        Finish->Callback(Finish->UserData);
+    }
+
+    Connection->FinishCallbacks = NULL;
+}
+
+static void HttpConnectionClose(http_worker *Worker, http_connection *Connection) {
+    HttpWorkerUnlinkConnection(Worker, Connection);
+    HttpConnectionRunFinishCallbacks(Connection);
+
+    // NOTE(oleh): Closing the descriptor also removes it from the epoll interest list.
+    close(Connection->Sock);
+    Connection->Sock = -1;
+
+    Connection->NextFree = Worker->FreeConnections;
+    Worker->FreeConnections = Connection;
+}
+
+static void HttpConnectionAppendOutput(http_connection *Connection, http_output *Output) {
+    Output->Next = NULL;
+
+    if (Connection->OutputTail != NULL) Connection->OutputTail->Next = Output;
+    else Connection->OutputHead = Output;
+
+    Connection->OutputTail = Output;
+    Connection->OutputQueued += Output->Data.Count;
+    Connection->OutputTotal += Output->Data.Count;
+}
+
+static void HttpConnectionQueueOutput(http_connection *Connection, string_view Data) {
+    if (Data.Count == 0) return;
+
+    http_output *Output = ARENA_NEW(&Connection->Arena, http_output);
+    Output->Data = Data;
+    HttpConnectionAppendOutput(Connection, Output);
+}
+
+// NOTE(oleh): Writes the decimal digits of `Value` right-aligned into the end of `Buffer` and returns where they start.
+static u8 *FormatU64Backwards(u8 *BufferEnd, u64 Value) {
+    u8 *Ptr = BufferEnd;
+    do {
+        *--Ptr = '0' + (Value % 10);
+        Value /= 10;
+    } while (Value != 0);
+    return Ptr;
+}
+
+static void HttpConnectionQueueResponse(http_connection *Connection, http_version Version, http_response_status Status,
+                                        string_view Headers, string_view Content) {
+    // 1. Status line. (https://datatracker.ietf.org/doc/html/rfc2616#section-6.1)
+
+    HttpConnectionQueueOutput(Connection, HttpVersionStrings[Version]);
+    HttpConnectionQueueOutput(Connection, GetHttpResponseStaticHead(Status));
+
+    // 2. Headers. (https://datatracker.ietf.org/doc/html/rfc2616#section-8.1.2.1)
+
+    const char ContentLength[] = "Content-Length: ";
+    const char ConnectionClose[] = "Connection: close\r\n";
+    const uz MaxDynamicHeadSize = (sizeof(ContentLength) - 1) + 20 + 2 + (sizeof(ConnectionClose) - 1);
+
+    u8 *DynamicHead = ArenaPush(&Connection->Arena, MaxDynamicHeadSize);
+    u8 *Ptr = DynamicHead;
+
+    // NOTE(oleh): A 304 stands in for the body the client already has, it must not announce a length of its own.
+    if (Status != HTTP_STATUS_NOT_MODIFIED) {
+        memcpy(Ptr, ContentLength, sizeof(ContentLength) - 1);
+        Ptr += sizeof(ContentLength) - 1;
+
+        u8 Digits[20];
+        u8 *DigitsStart = FormatU64Backwards(Digits + sizeof(Digits), Content.Count);
+        uz DigitsCount = Digits + sizeof(Digits) - DigitsStart;
+        memcpy(Ptr, DigitsStart, DigitsCount);
+        Ptr += DigitsCount;
+
+        memcpy(Ptr, "\r\n", 2);
+        Ptr += 2;
+    }
+
+    if (Connection->CloseAfterOutput) {
+        memcpy(Ptr, ConnectionClose, sizeof(ConnectionClose) - 1);
+        Ptr += sizeof(ConnectionClose) - 1;
+    }
+
+    HttpConnectionQueueOutput(Connection, (string_view) {.Items = DynamicHead, .Count = Ptr - DynamicHead});
+    HttpConnectionQueueOutput(Connection, Headers);
+    HttpConnectionQueueOutput(Connection, SV_LIT("\r\n"));
+
+    // 3. Body, never copied.
+
+    if (Status != HTTP_STATUS_NOT_MODIFIED) HttpConnectionQueueOutput(Connection, Content);
+}
+
+void HttpResponseAddHeader(http_response_context *Context, const char *Name, string_view Value) {
+    ASSERT(Context->Connection->Stream.Context != Context);
+
+    string_view Line = ArenaFormat(Context->Arena, "%s: " SV_FMT "\r\n", Name, SV_ARG(Value));
+
+    if (Context->Headers.Count == 0) {
+        Context->Headers = Line;
+    } else if (Context->Headers.Items + Context->Headers.Count == Line.Items) {
+        Context->Headers.Count += Line.Count;
+    } else {
+        string_view Headers = {.Items = ArenaPush(Context->Arena, Context->Headers.Count + Line.Count)};
+        memcpy(Headers.Items, Context->Headers.Items, Context->Headers.Count);
+        memcpy(Headers.Items + Context->Headers.Count, Line.Items, Line.Count);
+        Headers.Count = Context->Headers.Count + Line.Count;
+        Context->Headers = Headers;
+    }
+}
+
+void HttpResponseOnFinish(http_response_context *Context, http_response_finish_callback Callback, void *UserData) {
+    http_connection *Connection = Context->Connection;
+
+    http_finish_callback *Finish = ARENA_NEW(&Connection->Arena, http_finish_callback);
+    Finish->Callback = Callback;
+    Finish->UserData = UserData;
+    Finish->Next = Connection->FinishCallbacks;
+    Connection->FinishCallbacks = Finish;
+}
+
+static void HttpServerRecordMetrics(http_connection *Connection, u32 MetricsRoute, http_response_status Status,
+                                    uz RequestSize, u64 OutputTotalBefore, u64 StartNs) {
+    MetricsRecordRequest(MetricsRoute, Status, RequestSize, Connection->OutputTotal - OutputTotalBefore, GetMonotonicTimeNs() - StartNs);
+
+    MetricsRecordArenaHighWater(METRICS_ARENA_CONNECTION, Connection->Arena.HighWater);
+    MetricsRecordArenaHighWater(METRICS_ARENA_READ, Connection->ReadArena.Offset);
+    MetricsRecordArenaHighWater(METRICS_ARENA_SCRATCH, ScratchGetHighWater());
+}
+
+// NOTE(oleh): The latency recorded for a request is the time from it being parsed to its
+// response being queued, a streamed response counts until its last chunk is queued.
+static void HttpServerDispatch(http_server *Server, http_connection *Connection, const http_request *HttpRequest, uz RequestSize) {
+    u64 StartNs = GetMonotonicTimeNs();
+    u64 OutputTotalBefore = Connection->OutputTotal;
+    u32 MetricsRoute = METRICS_ROUTE_UNMATCHED(HttpRequest->Method);
+
+    // NOTE(oleh): The context outlives the handler when the response is streamed.
+    http_response_context *ResponseContext = ARENA_NEW(&Connection->Arena, http_response_context);
+    ResponseContext->Arena = &Connection->Arena;
+    ResponseContext->Request = *HttpRequest;
+    ResponseContext->Connection = Connection;
+
+    http_response_status ResponseStatus;
+
+    http_route_params Params;
+    Params.Count = 0;
+
+    http_route_node *Route = HttpRouteLookup(Server->Routes, HttpRequest->Path, &Params);
+    if (Route != NULL) MetricsRoute = Route->MetricsRoutes[HttpRequest->Method];
+
+    if (Route == NULL) {
+        ResponseStatus = HTTP_STATUS_NOT_FOUND;
+    } else if (Route->Handlers[HttpRequest->Method] == NULL) {
+        ResponseStatus = HTTP_STATUS_METHOD_NOT_ALLOWED;
+    } else {
+        if (Params.Count != 0) {
+            ResponseContext->Request.Params.Items = ArenaPush(&Connection->Arena, sizeof(http_path_param) * Params.Count);
+            ResponseContext->Request.Params.Count = Params.Count;
+            memcpy(ResponseContext->Request.Params.Items, Params.Items, sizeof(http_path_param) * Params.Count);
+        }
+
+        ResponseStatus = Route->Handlers[HttpRequest->Method](ResponseContext);
+    }
+
+    http_stream *Stream = &Connection->Stream;
+
+    if (Stream->Produce == NULL || ResponseStatus != HTTP_STATUS_OK) {
+        Stream->Produce = NULL;
+        HttpConnectionQueueResponse(Connection, HttpRequest->Version, ResponseStatus, ResponseContext->Headers, ResponseContext->Content);
+        HttpServerRecordMetrics(Connection, MetricsRoute, ResponseStatus, RequestSize, OutputTotalBefore, StartNs);
+        return;
+    }
+
+    // NOTE(oleh): The head is queued behind the responses to the earlier pipelined requests,
+    // the body is produced once the connection gets to it.
+    // (https://datatracker.ietf.org/doc/html/rfc2616#section-3.6.1)
+    HttpConnectionQueueOutput(Connection, HttpVersionStrings[HttpRequest->Version]);
+    HttpConnectionQueueOutput(Connection, GetHttpResponseStaticHead(HTTP_STATUS_OK));
+    HttpConnectionQueueOutput(Connection, SV_LIT("Transfer-Encoding: chunked\r\n"));
+    if (Connection->CloseAfterOutput) HttpConnectionQueueOutput(Connection, SV_LIT("Connection: close\r\n"));
+    HttpConnectionQueueOutput(Connection, ResponseContext->Headers);
+    HttpConnectionQueueOutput(Connection, SV_LIT("\r\n"));
+
+    Stream->Context = ResponseContext;
+    Stream->MetricsRoute = MetricsRoute;
+    Stream->RequestSize = RequestSize;
+    Stream->OutputTotalBefore = OutputTotalBefore;
+    Stream->StartNs = StartNs;
+}
+
+#define HTTP_MAX_IOVECS 64
+
+// NOTE(oleh): Returns 0 if the connection has to be closed.
+static b32 HttpConnectionFlush(http_worker *Worker, http_connection *Connection) {
+    while (Connection->OutputHead != NULL) {
+        struct iovec Iovecs[HTTP_MAX_IOVECS];
+        int IovecsCount = 0;
+
+        for (http_output *Output = Connection->OutputHead; Output != NULL && IovecsCount < HTTP_MAX_IOVECS; Output = Output->Next) {
+            uz Skip = IovecsCount == 0 ? Connection->OutputSent : 0;
+            Iovecs[IovecsCount].iov_base = Output->Data.Items + Skip;
+            Iovecs[IovecsCount].iov_len = Output->Data.Count - Skip;
+            ++IovecsCount;
+        }
+
+        struct msghdr Message = {0};
+        Message.msg_iov = Iovecs;
+        Message.msg_iovlen = IovecsCount;
+
+        sz SentBytesCount = sendmsg(Connection->Sock, &Message, MSG_NOSIGNAL);
+        if (SentBytesCount == -1) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 1;
+            return 0;
+        }
+
+        HttpWorkerTouchConnection(Worker, Connection);
+
+        uz Remaining = SentBytesCount;
+        while (Remaining != 0) {
+            http_output *Output = Connection->OutputHead;
+            uz Left = Output->Data.Count - Connection->OutputSent;
+
+            if (Remaining < Left) {
+                Connection->OutputSent += Remaining;
+                break;
+            }
+
+            Remaining -= Left;
+            Connection->OutputQueued -= Output->Data.Count;
+            Connection->OutputSent = 0;
+            Connection->OutputHead = Output->Next;
+            if (Connection->OutputHead == NULL) Connection->OutputTail = NULL;
+        }
+    }
+
+    return 1;
+}
+
+void HttpResponseStream(http_response_context *Context, http_stream_producer Produce, void *State) {
+    http_stream *Stream = &Context->Connection->Stream;
+    ASSERT(Stream->Context == NULL);
+
+    Stream->Produce = Produce;
+    Stream->State = State;
+}
+
+void HttpResponseWrite(http_response_context *Context, string_view Data) {
+    http_connection *Connection = Context->Connection;
+    ASSERT(Connection->Stream.Context == Context);
+
+    // NOTE(oleh): An empty chunk would end the body.
+    if (Data.Count == 0) return;
+
+    u8 SizeLine[2 * sizeof(uz) + 2];
+    u8 *SizeStart = SizeLine + 2 * sizeof(uz);
+    SizeStart[0] = '\r';
+    SizeStart[1] = '\n';
+
+    uz Size = Data.Count;
+    do {
+        *--SizeStart = "0123456789abcdef"[Size & 0xF];
+        Size >>= 4;
+    } while (Size != 0);
+
+    uz SizeLineCount = SizeLine + sizeof(SizeLine) - SizeStart;
+
+    http_output *Output = ARENA_NEW(&Connection->StreamArena, http_output);
+    Output->Data.Count = SizeLineCount + Data.Count + 2;
+    Output->Data.Items = ArenaPush(&Connection->StreamArena, Output->Data.Count);
+
+    memcpy(Output->Data.Items, SizeStart, SizeLineCount);
+    memcpy(Output->Data.Items + SizeLineCount, Data.Items, Data.Count);
+    memcpy(Output->Data.Items + SizeLineCount + Data.Count, "\r\n", 2);
+
+    HttpConnectionAppendOutput(Connection, Output);
+}
+
+// NOTE(oleh): Asks the producer for more until enough of the body is waiting for the client, the
+// rest is produced once the socket took that. Nothing here ever waits for the client.
+static void HttpConnectionContinueStream(http_connection *Connection) {
+    http_stream *Stream = &Connection->Stream;
+
+    while (Connection->StreamArena.Offset < HTTP_MAX_STREAM_BUFFERED) {
+        http_stream_result Result = Stream->Produce(Stream->Context, Stream->State);
+        if (Result == HTTP_STREAM_MORE) continue;
+
+        http_response_status Status = HTTP_STATUS_OK;
+        if (Result == HTTP_STREAM_DONE) {
+            HttpConnectionQueueOutput(Connection, SV_LIT("0\r\n\r\n"));
+        } else {
+            Connection->Aborted = 1;
+            Status = HTTP_STATUS_INTERNAL_SERVER_ERROR;
+        }
+
+        HttpServerRecordMetrics(Connection, Stream->MetricsRoute, Status, Stream->RequestSize, Stream->OutputTotalBefore, Stream->StartNs);
+
+        *Stream = (http_stream) {0};
+        return;
+    }
+}
+
+// NOTE(oleh): Answers input that never became a request, the status is still counted in the metrics.
+static void HttpConnectionAnswerUnparsed(http_connection *Connection, http_response_status Status, uz InputSize) {
+    u64 StartNs = GetMonotonicTimeNs();
+    u64 OutputTotalBefore = Connection->OutputTotal;
+
+    HttpConnectionQueueResponse(Connection, HTTP_1_1, Status, (string_view) {0}, (string_view) {0});
+    HttpServerRecordMetrics(Connection, METRICS_ROUTE_UNPARSED, Status, InputSize, OutputTotalBefore, StartNs);
+}
+
+typedef enum {
+    HTTP_NEXT_REQUEST_ANSWERED,
+    HTTP_NEXT_REQUEST_INCOMPLETE,
+    HTTP_NEXT_REQUEST_ERROR,
+} http_next_request_result;
+
+static http_next_request_result HttpConnectionAnswerNextRequest(http_server *Server, http_connection *Connection) {
+    arena *ReadArena = &Connection->ReadArena;
+
+    string_view ParseBuffer = {
+        .Items = ReadArena->Items + Connection->ParseOffset,
+        .Count = ReadArena->Offset - Connection->ParseOffset,
+    };
+
+    http_request HttpRequest;
+    http_parse_result ParseResult = HttpRequestParserFeed(&Connection->Parser, &Connection->Arena, ParseBuffer, &HttpRequest);
+    if (ParseResult == HTTP_PARSE_INCOMPLETE) return HTTP_NEXT_REQUEST_INCOMPLETE;
+
+    if (ParseResult == HTTP_PARSE_ERROR) {
+        // NOTE(oleh): There is no telling where the next request starts, so this is the last answer.
+        Connection->CloseAfterOutput = 1;
+        HttpConnectionAnswerUnparsed(Connection, Connection->Parser.ErrorStatus, ParseBuffer.Count);
+        return HTTP_NEXT_REQUEST_ERROR;
+    }
+
+    uz RequestSize = Connection->Parser.Position;
+    Connection->ParseOffset += RequestSize;
+    HttpRequestParserInit(&Connection->Parser, Connection->ReadArena.Capacity);
+    ++Connection->RequestsCount;
+
+    string_view ConnectionOption;
+    if (HttpRequestGetHeader(&HttpRequest, "Connection", &ConnectionOption) &&
+        StringViewEqualIgnoreCaseCStr(ConnectionOption, "close")) {
+        Connection->CloseAfterOutput = 1;
+    }
+
+    if (Connection->RequestsCount >= HTTP_MAX_REQUESTS_PER_CONNECTION) Connection->CloseAfterOutput = 1;
+
+    HttpServerDispatch(Server, Connection, &HttpRequest, RequestSize);
+    return HTTP_NEXT_REQUEST_ANSWERED;
+}
+
+// NOTE(oleh): Called once all the queued output went out. Nothing points into the
+// arenas anymore, so the unparsed tail of the input is moved to the front.
+static void HttpConnectionRecycle(http_connection *Connection) {
+    arena *ReadArena = &Connection->ReadArena;
+
+    uz UnparsedCount = ReadArena->Offset - Connection->ParseOffset;
+    if (UnparsedCount != 0 && Connection->ParseOffset != 0) {
+        memmove(ReadArena->Items, ReadArena->Items + Connection->ParseOffset, UnparsedCount);
+    }
+
+    ReadArena->Offset = UnparsedCount;
+    Connection->ParseOffset = 0;
+    if (ReadArena->Committed > ARENA_RETAINED_SIZE) ArenaDecommitUnused(ReadArena);
+
+    HttpConnectionRunFinishCallbacks(Connection);
+    ArenaReset(&Connection->Arena);
+}
+
+typedef enum {
+    HTTP_RECEIVE_PROGRESS,
+    HTTP_RECEIVE_BLOCKED,
+    HTTP_RECEIVE_ERROR,
+} http_receive_result;
+
+static http_receive_result HttpConnectionReceive(http_worker *Worker, http_connection *Connection) {
+    if (Connection->ReadClosed) return HTTP_RECEIVE_BLOCKED;
+
+    arena *ReadArena = &Connection->ReadArena;
+    b32 Progress = 0;
+
+    while (1) {
+        uz AvailableBytes = ReadArena->Capacity - ReadArena->Offset;
+        if (AvailableBytes == 0) break;
+
+        uz ChunkSize = AvailableBytes < HTTP_RECV_CHUNK_SIZE ? AvailableBytes : HTTP_RECV_CHUNK_SIZE;
+
+        sz ReceivedBytesCount = recv(Connection->Sock, ArenaEnsure(ReadArena, ChunkSize), ChunkSize, 0);
+        if (ReceivedBytesCount == -1) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            printf("Could not receive data from the socket: %s\n", strerror(errno));
+            return HTTP_RECEIVE_ERROR;
+        }
+
+        if (ReceivedBytesCount == 0) {
+            Connection->ReadClosed = 1;
+            Progress = 1;
+            break;
+        }
+
+        ReadArena->Offset += ReceivedBytesCount;
+        Progress = 1;
+    }
+
+    if (Progress) HttpWorkerTouchConnection(Worker, Connection);
+
+    return Progress ? HTTP_RECEIVE_PROGRESS : HTTP_RECEIVE_BLOCKED;
+}
+
+// NOTE(oleh): Drives a connection as far as it can go without blocking. Pipelined requests
+// are answered in order, and the output is flushed before the arenas get recycled.
+// Returns 0 if the connection has to be closed.
+static b32 HttpConnectionProcess(http_worker *Worker, http_connection *Connection) {
+    while (1) {
+        // NOTE(oleh): Whether every complete request that came in so far is answered.
+        b32 AllAnswered = 0;
+
+        while (!Connection->CloseAfterOutput && !Connection->Aborted && Connection->Stream.Context == NULL &&
+               Connection->OutputQueued < HTTP_MAX_QUEUED_OUTPUT) {
+            http_next_request_result Result = HttpConnectionAnswerNextRequest(Worker->Server, Connection);
+            if (Result != HTTP_NEXT_REQUEST_ANSWERED) {
+                AllAnswered = 1;
+                break;
+            }
+        }
+
+        if (Connection->Stream.Context != NULL) HttpConnectionContinueStream(Connection);
+
+        if (Connection->Aborted) return 0;
+
+        if (!HttpConnectionFlush(Worker, Connection)) return 0;
+
+        if (Connection->OutputHead == NULL) {
+            ArenaReset(&Connection->StreamArena);
+
+            if (Connection->Stream.Context != NULL) continue;
+            if (Connection->CloseAfterOutput) return 0;
+
+            HttpConnectionRecycle(Connection);
+            if (!AllAnswered) continue;
+
+            if (Connection->ReadArena.Offset == Connection->ReadArena.Capacity) {
+                Connection->CloseAfterOutput = 1;
+                HttpConnectionAnswerUnparsed(Connection, HTTP_STATUS_PAYLOAD_TOO_LARGE, Connection->ReadArena.Offset);
+                continue;
+            }
+
+            // NOTE(oleh): The client is not going to send anything else and everything it did send is answered.
+            if (Connection->ReadClosed) return 0;
+        }
+
+        http_receive_result Result = HttpConnectionReceive(Worker, Connection);
+        if (Result == HTTP_RECEIVE_ERROR) return 0;
+        if (Result == HTTP_RECEIVE_BLOCKED) return 1;
+    }
+}
+
+static void HttpWorkerCloseIdleConnections(http_worker *Worker) {
+    u64 NowMs = GetMonotonicTimeMs();
+
+    while (Worker->OldestConnection != NULL) {
+        http_connection *Connection = Worker->OldestConnection;
+        if (NowMs - Connection->LastActivityMs < HTTP_IDLE_TIMEOUT_MS) break;
+
+        HttpConnectionClose(Worker, Connection);
+    }
+}
+
+static void HttpWorkerAcceptConnections(http_worker *Worker) {
+    while (1) {
+        struct sockaddr_storage ClientAddr;
+        socklen_t ClientAddrSize = sizeof(ClientAddr);
+
+        int ClientSock = accept4(Worker->ListenSock, (struct sockaddr *)&ClientAddr, &ClientAddrSize, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (ClientSock == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+
+            // NOTE(oleh): Running out of descriptors is not fatal, wait for some connections to go away.
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                printf("Could not accept a new connection: %s\n", strerror(errno));
+                return;
+            }
+
+            PANIC_FMT("Could not accept a new connection: %s", strerror(errno));
+        }
+
+        http_connection *Connection = HttpConnectionOpen(Worker, ClientSock);
+
+        struct epoll_event Event = {0};
+        Event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        Event.data.ptr = Connection;
+
+        if (epoll_ctl(Worker->EpollFd, EPOLL_CTL_ADD, ClientSock, &Event) == -1) {
+            printf("Could not register a connection with epoll: %s\n", strerror(errno));
+            HttpConnectionClose(Worker, Connection);
+        }
+    }
+}
+
+static int HttpListen(u16 Port) {
     struct addrinfo Hints = {0};
     struct addrinfo* ServerAddr;
 
@@ -166,7 +1327,7 @@ void HttpServerStart(http_server *Server, u16 Port) {
         PANIC_FMT("Call to getaddrinfo failed: %s\n", gai_strerror(Status));
     }
 
-    int ServerSock = socket(ServerAddr->ai_family, ServerAddr->ai_socktype, 0);
+    int ServerSock = socket(ServerAddr->ai_family, ServerAddr->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if (ServerSock == -1) {
         PANIC("call to `socket` failed");
     }
@@ -176,124 +1337,132 @@ void HttpServerStart(http_server *Server, u16 Port) {
         PANIC("Failed to set socket options");
     }
 
+    // NOTE(oleh): Every worker binds its own socket to the same port, the kernel balances
+    // incoming connections between them.
+    if (setsockopt(ServerSock, SOL_SOCKET, SO_REUSEPORT, &OptValue, sizeof(OptValue)) == -1) {
+        PANIC("Failed to set socket options");
+    }
+
     if (bind(ServerSock, ServerAddr->ai_addr, ServerAddr->ai_addrlen) == -1) {
         PANIC("Call to `bind` failed");
     }
 
+    freeaddrinfo(ServerAddr);
+
     if (listen(ServerSock, TCP_BACKLOG_SIZE) == -1) {
         PANIC("Call to `listen` failed");
     }
 
-    struct sockaddr_storage ClientAddr;
-    socklen_t ClientAddrSize = sizeof(ClientAddr);
+    return ServerSock;
+}
 
-    arena RequestArena;
-    ArenaInit(&RequestArena, DEFAULT_REQUEST_ARENA_CAPACITY);
+static void *HttpWorkerRun(void *Argument) {
+    http_worker *Worker = Argument;
 
-    http_response_context ResponseContext = {0};
-    ResponseContext.Arena = &RequestArena;
+    struct epoll_event Events[HTTP_SERVER_MAX_EVENTS];
+    u64 LastSweepMs = GetMonotonicTimeMs();
 
     while (1) {
-    ServerLoopStart:
-        ArenaReset(&RequestArena);
-        ResponseContext.Content = (string_view) {0};
-
-        int ClientSock = accept(ServerSock, (struct sockaddr*)&ClientAddr, &ClientAddrSize);
-        if (ClientSock == -1) {
-            int AcceptError = errno;
-            close(ServerSock);
-            PANIC_FMT("Could not accept a new connection: %s", strerror(AcceptError));
+        int EventsCount = epoll_wait(Worker->EpollFd, Events, HTTP_SERVER_MAX_EVENTS, HTTP_IDLE_SWEEP_INTERVAL_MS);
+        if (EventsCount == -1) {
+            if (errno == EINTR) continue;
+            PANIC_FMT("Call to `epoll_wait` failed: %s", strerror(errno));
         }
 
-        ssize_t ReceivedBytesCount = recv(ClientSock, RequestArena.Items, RequestArena.Capacity, 0);
-        if (ReceivedBytesCount == -1) {
-            printf("Could not receive data from the socket\n");
-            close(ClientSock);
-            continue;
-        }
+        for (int EventIndex = 0; EventIndex < EventsCount; ++EventIndex) {
+            struct epoll_event *Event = &Events[EventIndex];
 
-        ASSERT(RequestArena.Offset == 0);
+            if (Event->data.ptr == NULL) {
+                HttpWorkerAcceptConnections(Worker);
+                continue;
+            }
 
-        string_view ParseBuffer = {.Items = RequestArena.Items, .Count = ReceivedBytesCount};
+            http_connection *Connection = Event->data.ptr;
+            b32 KeepOpen = 1;
 
-        RequestArena.Offset = AlignForward(ReceivedBytesCount, sizeof(uz));
+            if (Event->events & EPOLLERR) KeepOpen = 0;
+            if (KeepOpen) KeepOpen = HttpConnectionProcess(Worker, Connection);
 
-        http_request HttpRequest;
-        b32 Success = HttpRequestParse(&RequestArena, ParseBuffer, &HttpRequest);
-        if (!Success) {
-            printf("Could not parse the HTTP request\n");
-            close(ClientSock);
-            continue;
+            if (!KeepOpen) HttpConnectionClose(Worker, Connection);
         }
 
-        for (uz HandlerIndex = 0; HandlerIndex < Server->HandlersCount; ++HandlerIndex) {
-            string_view HandlerPath = Server->HandlersPaths[HandlerIndex];
-            if (!StringViewEqual(HandlerPath, HttpRequest.Path)) continue;
+        u64 NowMs = GetMonotonicTimeMs();
+        if (NowMs - LastSweepMs >= HTTP_IDLE_SWEEP_INTERVAL_MS) {
+            HttpWorkerCloseIdleConnections(Worker);
+            LastSweepMs = NowMs;
+        }
+    }
 
-            http_request_handler Handler = Server->Handlers[HandlerIndex];
+    return NULL;
+}
 
-            ResponseContext.Request = HttpRequest;
-            http_response_status ResponseStatus = Handler(&ResponseContext);
+// NOTE(oleh): Connection structs are tiny, their arenas are reserved separately.
+#define HTTP_WORKER_ARENA_CAPACITY (64ll * 1024ll * 1024ll)
 
-            // 1. Status line. (https://datatracker.ietf.org/doc/html/rfc2616#section-6.1)
+static void HttpWorkerInit(http_server *Server, http_worker *Worker, u16 Port) {
+    Worker->Server = Server;
+    Worker->FreeConnections = NULL;
+    Worker->OldestConnection = NULL;
+    Worker->NewestConnection = NULL;
+    ArenaInit(&Worker->Arena, HTTP_WORKER_ARENA_CAPACITY);
 
-            const char *ReasonPhrase = GetHttpResponseStatusReasonPhrase(ResponseStatus);
-            const char *VersionString = HttpVersionStrings[HttpRequest.Version];
+    Worker->ListenSock = HttpListen(Port);
 
-            string_view ResponseString = ArenaFormat(&RequestArena,
-                                                     "%s %u %s\r\nAccess-Control-Allow-Origin: *\r\n\r\n" SV_FMT,
-                                                     VersionString,
-                                                     ResponseStatus,
-                                                     ReasonPhrase,
-                                                     SV_ARG(ResponseContext.Content));
+    Worker->EpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (Worker->EpollFd == -1) {
+        PANIC_FMT("Call to `epoll_create1` failed: %s", strerror(errno));
+    }
 
-            int SendStatus = send(ClientSock, ResponseString.Items, ResponseString.Count, 0);
-            ASSERT(SendStatus != -1);
+    // NOTE(oleh): The listening socket is the only one registered with a NULL pointer.
+    struct epoll_event ListenEvent = {0};
+    ListenEvent.events = EPOLLIN | EPOLLET;
+    ListenEvent.data.ptr = NULL;
 
-            close(ClientSock);
+    if (epoll_ctl(Worker->EpollFd, EPOLL_CTL_ADD, Worker->ListenSock, &ListenEvent) == -1) {
+        PANIC_FMT("Could not register the listening socket with epoll: %s", strerror(errno));
+    }
+}
 
-            goto ServerLoopStart;
-        }
+void HttpServerStart(http_server *Server, u16 Port) {
+    ASSERT(Server->WorkersCount > 0);
 
-        http_response_status ResponseStatus = HTTP_STATUS_NOT_FOUND;
-        const char *ReasonPhrase = GetHttpResponseStatusReasonPhrase(ResponseStatus);
-        const char *VersionString = HttpVersionStrings[HttpRequest.Version];
+    Server->Workers = ArenaPush(&Server->Arena, sizeof(*Server->Workers) * Server->WorkersCount);
 
-        // TODO(oleh): No handler found, just give em 404!
-        string_view ResponseString = ArenaFormat(&RequestArena,
-                                                 "%s %u %s\r\nAccess-Control-Allow-Origin: *\r\n\r\n",
-                                                 VersionString,
-                                                 ResponseStatus,
-                                                 ReasonPhrase);
+    for (uz WorkerIndex = 0; WorkerIndex < Server->WorkersCount; ++WorkerIndex) {
+        HttpWorkerInit(Server, &Server->Workers[WorkerIndex], Port);
+    }
 
-        int SendStatus = send(ClientSock, ResponseString.Items, ResponseString.Count, 0);
-        ASSERT(SendStatus != -1);
+    // NOTE(oleh): The calling thread becomes the first worker.
+    for (uz WorkerIndex = 1; WorkerIndex < Server->WorkersCount; ++WorkerIndex) {
+        http_worker *Worker = &Server->Workers[WorkerIndex];
 
-        close(ClientSock);
+        int Status = pthread_create(&Worker->Thread, NULL, HttpWorkerRun, Worker);
+        if (Status != 0) {
+            PANIC_FMT("Could not start a worker thread: %s", strerror(Status));
+        }
     }
+
+    Server->Workers[0].Thread = pthread_self();
+    HttpWorkerRun(&Server->Workers[0]);
 }
 
 // NOTE(oleh): Need to make sure that we are running on a system with virtual memory.
 #define HTTP_SERVER_ARENA_CAPACITY (4ll * 1024ll * 1024ll * 1024ll)
 
-// If you need more, seek help.
-#define HTTP_SERVER_MAX_HANDLERS (100)
+void HttpServerAttachHandler(http_server *Server, http_method Method, const char *Path, http_request_handler Handler) {
+    string_view PathSv = SV_LIT(Path);
+    if (PathSv.Count == 0 || PathSv.Items[0] != '/') PANIC_FMT("Handler paths have to start with a '/', got '%s'", Path);
 
-void HttpServerAttachHandler(http_server *Server, const char *Path, http_request_handler Handler) {
-    if (Server->HandlersCount >= HTTP_SERVER_MAX_HANDLERS)
-        PANIC_FMT("Maximum amount of handlers (%d) reached!", HTTP_SERVER_MAX_HANDLERS);
-
-    uz HandlersCount = Server->HandlersCount;
-    Server->HandlersPaths[HandlersCount] = SV_LIT(Path);
-    Server->Handlers[HandlersCount] = Handler;
-    ++Server->HandlersCount;
+    HttpRouteInsert(&Server->Arena, Server->Routes, Path, Method, Handler);
 }
 
 void HttpServerInit(http_server *Server) {
     ArenaInit(&Server->Arena, HTTP_SERVER_ARENA_CAPACITY);
 
-    Server->Handlers = ArenaPush(&Server->Arena, sizeof(*Server->Handlers) * HTTP_SERVER_MAX_HANDLERS);
-    Server->HandlersPaths = ArenaPush(&Server->Arena, sizeof(*Server->HandlersPaths) * HTTP_SERVER_MAX_HANDLERS);
+    Server->Routes = ARENA_NEW(&Server->Arena, http_route_node);
+
+    Server->Workers = NULL;
 
-    Server->HandlersCount = 0;
+    long OnlineCpusCount = sysconf(_SC_NPROCESSORS_ONLN);
+    Server->WorkersCount = OnlineCpusCount > 0 ? (uz)OnlineCpusCount : 1;
 }
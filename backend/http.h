@@ -3,6 +3,8 @@
 
 #include "common.h"
 
+#include <pthread.h>
+
 // NOTE(oleh): https://datatracker.ietf.org/doc/html/rfc2616#section-5.1.1
 #define ENUM_HTTP_METHODS                   \
     X(OPTIONS)                              \
@@ -17,6 +19,7 @@ typedef enum {
 #define X(method) HTTP_##method,
     ENUM_HTTP_METHODS
 #undef X
+    HTTP_METHODS_COUNT,
 } http_method;
 
 typedef struct {
@@ -38,21 +41,49 @@ ENUM_HTTP_VERSIONS
 #undef X
 } http_version;
 
+// NOTE(oleh): Values of the `:name` segments of the route that matched the request path.
+typedef struct {
+    string_view Name;
+    string_view Value;
+} http_path_param;
+
+typedef struct {
+    http_path_param *Items;
+    uz Count;
+} http_path_params;
+
 typedef struct {
     http_method Method;
     string_view Path;
+    // NOTE(oleh): Everything after the '?' of the request target, without the '?' itself.
+    string_view Query;
     http_version Version;
     http_headers Headers;
+    http_path_params Params;
     string_view Body;
 } http_request;
 
-b32 HttpRequestParse(arena *Arena, string_view Buffer, http_request *Out);
+// NOTE(oleh): Header names are compared case-insensitively.
+b32 HttpRequestGetHeader(const http_request *Request, const char *Name, string_view *OutValue);
+
+b32 HttpRequestGetParam(const http_request *Request, const char *Name, string_view *OutValue);
+
+// NOTE(oleh): Looks `Name` up in the `a=1&b=2` query string, the first occurrence wins. Values that
+// are percent-encoded are decoded into `Arena`, the rest point into the request.
+b32 HttpRequestGetQueryParam(arena *Arena, const http_request *Request, const char *Name, string_view *OutValue);
+
+// NOTE(oleh): Whether `If-None-Match` lists `ETag`, which has to include its quotes.
+// (https://datatracker.ietf.org/doc/html/rfc7232#section-3.2)
+b32 HttpRequestMatchesETag(const http_request *Request, string_view ETag);
 
 #define ENUM_HTTP_RESPONSE_STATUSES                             \
     X(OK, 200, "OK")                                            \
+        X(NOT_MODIFIED, 304, "Not Modified")                    \
         X(BAD_REQUEST, 400, "Bad Request")                      \
         X(NOT_FOUND, 404, "Not Found")                          \
         X(METHOD_NOT_ALLOWED, 405, "Method Not Allowed")        \
+        X(CONFLICT, 409, "Conflict")                            \
+        X(PAYLOAD_TOO_LARGE, 413, "Payload Too Large")          \
         X(INTERNAL_SERVER_ERROR, 500, "Internal Server Error")  \
 
 typedef enum {
@@ -61,27 +92,151 @@ typedef enum {
 #undef X
 } http_response_status;
 
+typedef enum {
+    HTTP_PARSE_METHOD,
+    HTTP_PARSE_PATH,
+    HTTP_PARSE_VERSION,
+    HTTP_PARSE_REQUEST_LINE_LF,
+    HTTP_PARSE_HEADER_LINE_START,
+    HTTP_PARSE_HEADER_NAME,
+    HTTP_PARSE_HEADER_VALUE,
+    HTTP_PARSE_HEADER_LINE_LF,
+    HTTP_PARSE_HEADERS_END_LF,
+    HTTP_PARSE_BODY,
+    HTTP_PARSE_CHUNK_SIZE,
+    HTTP_PARSE_CHUNK_EXTENSION,
+    HTTP_PARSE_CHUNK_SIZE_LF,
+    HTTP_PARSE_CHUNK_DATA,
+    HTTP_PARSE_CHUNK_DATA_CR,
+    HTTP_PARSE_CHUNK_DATA_LF,
+    HTTP_PARSE_TRAILER_LINE_START,
+    HTTP_PARSE_TRAILER_LINE,
+    HTTP_PARSE_TRAILER_END_LF,
+    HTTP_PARSE_DONE,
+} http_parser_state;
+
+typedef enum {
+    HTTP_PARSE_INCOMPLETE,
+    HTTP_PARSE_COMPLETE,
+    HTTP_PARSE_ERROR,
+} http_parse_result;
+
+#define HTTP_MAX_HEADERS 64
+
+// NOTE(oleh): Everything is stored as an offset from the start of the request, so the
+// input buffer is free to move between two feeds.
+typedef struct {
+    u32 NameStart;
+    u32 NameCount;
+    u32 ValueStart;
+    u32 ValueCount;
+} http_parser_header;
+
+typedef struct {
+    http_parser_state State;
+    uz Position;
+    uz TokenStart;
+    uz MaxRequestSize;
+
+    http_method Method;
+    uz PathStart;
+    uz PathCount;
+    http_version Version;
+
+    http_parser_header Headers[HTTP_MAX_HEADERS];
+    uz HeadersCount;
+
+    // NOTE(oleh): Chunked bodies are decoded in place, the data is moved down to `BodyEnd`.
+    uz BodyStart;
+    uz BodyEnd;
+    uz BodyRemaining;
+
+    http_response_status ErrorStatus;
+} http_request_parser;
+
+void HttpRequestParserInit(http_request_parser *Parser, uz MaxRequestSize);
+
+// NOTE(oleh): `Buffer` has to start at the first byte of the request and may only grow
+// between calls. Bytes that were already consumed are never looked at again. On success,
+// `Parser->Position` is the size of the request and `Out` points into `Buffer`.
+http_parse_result HttpRequestParserFeed(http_request_parser *Parser, arena *Arena, string_view Buffer, http_request *Out);
+
+struct http_connection;
+typedef struct http_connection http_connection;
+
 typedef struct {
     arena *Arena;
     http_request Request;
     string_view Content;
+    // NOTE(oleh): Extra header lines, each one ending with CRLF. Filled by `HttpResponseAddHeader`.
+    string_view Headers;
+
+    http_connection *Connection;
 } http_response_context;
 
 typedef http_response_status (*http_request_handler)(http_response_context *);
 
+struct http_server;
+typedef struct http_server http_server;
+
+// NOTE(oleh): Every worker runs its own event loop on its own thread, with its own
+// SO_REUSEPORT listening socket, so workers never contend with each other.
 typedef struct {
-    // TODO(oleh): Probably introduce a thread pool and accepting socket fd here.
+    http_server *Server;
+    arena Arena;
+    int ListenSock;
+    int EpollFd;
+    http_connection *FreeConnections;
+    // NOTE(oleh): Open connections ordered by their last activity, used to close idle ones.
+    http_connection *OldestConnection;
+    http_connection *NewestConnection;
+    pthread_t Thread;
+} http_worker;
+
+struct http_route_node;
+typedef struct http_route_node http_route_node;
+
+struct http_server {
     arena Arena;
-    string_view *HandlersPaths;
-    http_request_handler *Handlers;
-    uz HandlersCount;
-} http_server;
+    http_worker *Workers;
+    uz WorkersCount;
+    // NOTE(oleh): Radix tree of the attached paths, only read once the workers are running.
+    http_route_node *Routes;
+};
 
 void HttpServerInit(http_server *);
 
-void HttpResponseWrite(http_response_context *, string_view);
+// NOTE(oleh): Only for handlers, producers of streamed responses are too late for that.
+void HttpResponseAddHeader(http_response_context *, const char *Name, string_view Value);
+
+// NOTE(oleh): `Callback` runs once the response went out or the connection got closed before
+// that, whichever comes first. `Content` may point into memory that the callback releases.
+typedef void (*http_response_finish_callback)(void *UserData);
+void HttpResponseOnFinish(http_response_context *, http_response_finish_callback Callback, void *UserData);
+
+typedef enum {
+    HTTP_STREAM_MORE,
+    HTTP_STREAM_DONE,
+    HTTP_STREAM_FAILED,
+} http_stream_result;
+
+typedef http_stream_result (*http_stream_producer)(http_response_context *, void *State);
+
+// NOTE(oleh): Makes a 200 response have a chunked body, so big bodies never have to be held in
+// memory whole. Once the handler returns, the worker calls `Produce` whenever the client can take
+// more, and it hands the next piece of the body over with `HttpResponseWrite`. A slow client is
+// simply asked less often, the worker goes on serving the other connections meanwhile. After
+// `HTTP_STREAM_FAILED` the connection is cut, the client has no other way of learning about it.
+// `State` has to outlive the handler, `HttpResponseOnFinish` is the place to release it.
+void HttpResponseStream(http_response_context *, http_stream_producer Produce, void *State);
+
+// NOTE(oleh): Only for producers. Queues `Data` as the next chunk, it is copied so the producer
+// can reuse it right after.
+void HttpResponseWrite(http_response_context *, string_view Data);
 
 void HttpServerStart(http_server *Server, u16 Port);
-void HttpServerAttachHandler(http_server *Server, const char *Path, http_request_handler Handler);
+// NOTE(oleh): `Path` may contain parameter segments like `/projects/:id`, their values end up
+// in the request params. A path that is attached for other methods only answers with 405.
+void HttpServerAttachHandler(http_server *Server, http_method Method, const char *Path, http_request_handler Handler);
 
 #endif // HTTP_H_
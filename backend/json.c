@@ -1,35 +1,44 @@
 #include "json.h"
+#include "scan.h"
+#include "number.h"
+
+typedef enum {
+    TOKEN_LBRACKET,
+    TOKEN_RBRACKET,
+    TOKEN_LBRACE,
+    TOKEN_RBRACE,
+    TOKEN_STRING,
+    TOKEN_NUMBER,
+    TOKEN_NULL,
+    TOKEN_TRUE,
+    TOKEN_FALSE,
+    TOKEN_COLON,
+    TOKEN_COMMA,
+
+    TOKEN_ILLEGAL,
+    TOKEN_UNCLOSED_STRING,
+} json_token_type;
 
 typedef struct {
-    enum {
-        TOKEN_LBRACKET,
-        TOKEN_RBRACKET,
-        TOKEN_LBRACE,
-        TOKEN_RBRACE,
-        TOKEN_STRING,
-        TOKEN_NUMBER,
-        TOKEN_NULL,
-        TOKEN_TRUE,
-        TOKEN_FALSE,
-        TOKEN_COLON,
-        TOKEN_COMMA,
-
-        TOKEN_ILLEGAL,
-        TOKEN_UNCLOSED_STRING,
-    } Type;
+    json_token_type Type;
     string_view Value;
+    // NOTE(oleh): Strings are handed out raw, this tells whether they have to be unescaped.
+    b32 Escaped;
 } json_token;
 
 static inline b32 JsonIsWhitespace(u8 Char) {
     return Char == 0x20 || Char == 0x0A || Char == 0x0D || Char == 0x09;
 }
 
+// NOTE(oleh): Bytes that end a literal or a number.
+static inline b32 JsonIsDelimiter(u8 Char) {
+    return JsonIsWhitespace(Char) || Char == ',' || Char == ':' || Char == '[' || Char == ']' || Char == '{' || Char == '}' || Char == '"';
+}
+
 static b32 JsonNextToken(string_view Input, uz *Position, json_token *OutToken) {
     uz CurrentPosition = *Position;
 
-    for (; CurrentPosition < Input.Count; ++CurrentPosition) {
-        if (!JsonIsWhitespace(Input.Items[CurrentPosition])) break;
-    }
+    CurrentPosition += ScanSkipJsonWhitespace(Input.Items + CurrentPosition, Input.Count - CurrentPosition);
 
     if (CurrentPosition >= Input.Count) return 0;
 
@@ -40,57 +49,74 @@ static b32 JsonNextToken(string_view Input, uz *Position, json_token *OutToken)
         OutToken->Type = TOKEN_LBRACKET;
         OutToken->Value.Items = Input.Items + CurrentPosition;
         OutToken->Value.Count = 1;
-        *Position += 1;
+        *Position = CurrentPosition + 1;
         return 1;
     }
     case ']': {
         OutToken->Type = TOKEN_RBRACKET;
         OutToken->Value.Items = Input.Items + CurrentPosition;
         OutToken->Value.Count = 1;
-        *Position += 1;
+        *Position = CurrentPosition + 1;
         return 1;
     }
     case '{': {
         OutToken->Type = TOKEN_LBRACE;
         OutToken->Value.Items = Input.Items + CurrentPosition;
         OutToken->Value.Count = 1;
-        *Position += 1;
+        *Position = CurrentPosition + 1;
         return 1;
     }
     case '}': {
         OutToken->Type = TOKEN_RBRACE;
         OutToken->Value.Items = Input.Items + CurrentPosition;
         OutToken->Value.Count = 1;
-        *Position += 1;
+        *Position = CurrentPosition + 1;
         return 1;
     }
     case ',': {
         OutToken->Type = TOKEN_COMMA;
         OutToken->Value.Items = Input.Items + CurrentPosition;
         OutToken->Value.Count = 1;
-        *Position += 1;
+        *Position = CurrentPosition + 1;
         return 1;
     }
     case ':': {
         OutToken->Type = TOKEN_COLON;
         OutToken->Value.Items = Input.Items + CurrentPosition;
         OutToken->Value.Count = 1;
-        *Position += 1;
+        *Position = CurrentPosition + 1;
         return 1;
     }
     case '"': {
         uz StringStart = CurrentPosition + 1;
-        for (CurrentPosition = StringStart; CurrentPosition < Input.Count; ++CurrentPosition) {
-            if (Input.Items[CurrentPosition] == '"') break;
-        }
+        OutToken->Type = TOKEN_UNCLOSED_STRING;
+        OutToken->Escaped = 0;
+
+        // NOTE(oleh): Escapes are only skipped over here, whatever follows a backslash can't end the string.
+        CurrentPosition = StringStart;
+        while (CurrentPosition < Input.Count) {
+            CurrentPosition += ScanFindJsonStringSpecial(Input.Items + CurrentPosition, Input.Count - CurrentPosition);
+            if (CurrentPosition >= Input.Count) break;
+
+            u8 Char = Input.Items[CurrentPosition];
+            if (Char == '"') {
+                OutToken->Type = TOKEN_STRING;
+                break;
+            }
 
-        if (CurrentPosition >= Input.Count) {
-            OutToken->Type = TOKEN_UNCLOSED_STRING;
-            --StringStart;
-        } else {
-            OutToken->Type = TOKEN_STRING;
+            if (Char != '\\') {
+                // NOTE(oleh): Control characters have to be escaped.
+                OutToken->Type = TOKEN_ILLEGAL;
+                break;
+            }
+
+            OutToken->Escaped = 1;
+            CurrentPosition += 2;
         }
 
+        if (CurrentPosition > Input.Count) CurrentPosition = Input.Count;
+        if (OutToken->Type != TOKEN_STRING) --StringStart;
+
         OutToken->Value.Items = Input.Items + StringStart;
         OutToken->Value.Count = CurrentPosition - StringStart;
 
@@ -100,7 +126,7 @@ static b32 JsonNextToken(string_view Input, uz *Position, json_token *OutToken)
     default: {
         uz ValueStart = CurrentPosition;
         for (; CurrentPosition < Input.Count; ++CurrentPosition) {
-            if (JsonIsWhitespace(Input.Items[CurrentPosition])) break;
+            if (JsonIsDelimiter(Input.Items[CurrentPosition])) break;
         }
 
         string_view Value = {.Items = Input.Items + ValueStart, .Count = CurrentPosition - ValueStart};
@@ -111,312 +137,833 @@ static b32 JsonNextToken(string_view Input, uz *Position, json_token *OutToken)
         } else if (StringViewEqualCStr(Value, "null")) {
             OutToken->Type = TOKEN_NULL;
         } else {
-            int TokenType = TOKEN_NUMBER;
-
-            for (uz I = 0; I < Value.Count; ++I) {
-                u8 Char = Value.Items[I];
-                if (Char < '0' || Char > '9') {
-                    TokenType = TOKEN_ILLEGAL;
-                    break;
-                }
-            }
-
-            OutToken->Type = TokenType;
+            // NOTE(oleh): The rest of the grammar is checked when the number gets parsed.
+            u8 FirstChar = Value.Items[0];
+            OutToken->Type = (FirstChar == '-' || (FirstChar >= '0' && FirstChar <= '9')) ? TOKEN_NUMBER : TOKEN_ILLEGAL;
         }
 
         OutToken->Value = Value;
+        *Position = CurrentPosition;
         return 1;
     }
     }
 }
 
-static b32 JsonPeekToken(string_view Input, uz *Position, json_token *OutToken) {
-    uz SavedPosition = *Position;
-    b32 Result = JsonNextToken(Input, Position, OutToken);
-    *Position = SavedPosition;
-    return Result;
+static inline b32 JsonParseHex4(const u8 *Ptr, u32 *Out) {
+    u32 Value = 0;
+
+    for (uz I = 0; I < 4; ++I) {
+        u8 Char = Ptr[I];
+        Value <<= 4;
+
+        if (Char >= '0' && Char <= '9') Value |= Char - '0';
+        else if (Char >= 'a' && Char <= 'f') Value |= Char - 'a' + 10;
+        else if (Char >= 'A' && Char <= 'F') Value |= Char - 'A' + 10;
+        else return 0;
+    }
+
+    *Out = Value;
+    return 1;
 }
 
-static f64 ParseF64(string_view Buffer) {
-    ASSERT(Buffer.Count != 0);
+static inline uz JsonEncodeUtf8(u32 Codepoint, u8 *Out) {
+    if (Codepoint < 0x80) {
+        Out[0] = (u8)Codepoint;
+        return 1;
+    }
 
-    u64 Mult = 1;
-    u64 Result = 0;
-    for (uz I = Buffer.Count - 1; I > 0; --I) {
-        u8 Char = Buffer.Items[I];
-        // TODO(oleh): Provide a way to signal error to the caller.
-        if (Char < '0' || Char > '9') PANIC("Bad input to 'ParseF64'");
-        Result += Mult * (Char - '0');
-        Mult *= 10;
+    if (Codepoint < 0x800) {
+        Out[0] = (u8)(0xC0 | (Codepoint >> 6));
+        Out[1] = (u8)(0x80 | (Codepoint & 0x3F));
+        return 2;
     }
 
-    if (Buffer.Items[0] == '-') {
-        return (f64)-(s64)Result;
+    if (Codepoint < 0x10000) {
+        Out[0] = (u8)(0xE0 | (Codepoint >> 12));
+        Out[1] = (u8)(0x80 | ((Codepoint >> 6) & 0x3F));
+        Out[2] = (u8)(0x80 | (Codepoint & 0x3F));
+        return 3;
     }
 
-    return (f64)Result;
+    Out[0] = (u8)(0xF0 | (Codepoint >> 18));
+    Out[1] = (u8)(0x80 | ((Codepoint >> 12) & 0x3F));
+    Out[2] = (u8)(0x80 | ((Codepoint >> 6) & 0x3F));
+    Out[3] = (u8)(0x80 | (Codepoint & 0x3F));
+    return 4;
 }
 
-#define DEFAULT_OBJECT_CAPACITY 37
+// NOTE(oleh): Decodes the escape sequence right after a backslash into at most 4 bytes of `Out`.
+// Returns the count of input bytes it took, or 0 if the escape is malformed. Surrogates only
+// come in pairs, a lone one has no UTF-8 encoding.
+static uz JsonDecodeEscape(const u8 *Ptr, const u8 *End, u8 *Out, uz *OutCount) {
+    if (Ptr == End) return 0;
+
+    u8 Simple;
+    switch (*Ptr) {
+    case '"': Simple = '"'; break;
+    case '\\': Simple = '\\'; break;
+    case '/': Simple = '/'; break;
+    case 'b': Simple = '\b'; break;
+    case 'f': Simple = '\f'; break;
+    case 'n': Simple = '\n'; break;
+    case 'r': Simple = '\r'; break;
+    case 't': Simple = '\t'; break;
+    case 'u': {
+        u32 Codepoint;
+        if (End - Ptr < 5 || !JsonParseHex4(Ptr + 1, &Codepoint)) return 0;
+
+        if (Codepoint >= 0xDC00 && Codepoint <= 0xDFFF) return 0;
+
+        if (Codepoint >= 0xD800 && Codepoint <= 0xDBFF) {
+            u32 Low;
+            if (End - Ptr < 11 || Ptr[5] != '\\' || Ptr[6] != 'u' || !JsonParseHex4(Ptr + 7, &Low)) return 0;
+            if (Low < 0xDC00 || Low > 0xDFFF) return 0;
+
+            *OutCount = JsonEncodeUtf8(0x10000 + ((Codepoint - 0xD800) << 10) + (Low - 0xDC00), Out);
+            return 11;
+        }
 
-static b32 JsonParseValue(arena *Arena, string_view Input, uz *Position, json_value *OutValue) {
-    json_token Token;
+        *OutCount = JsonEncodeUtf8(Codepoint, Out);
+        return 5;
+    }
+    default: return 0;
+    }
 
-    if (!JsonNextToken(Input, Position, &Token)) return 0;
+    *Out = Simple;
+    *OutCount = 1;
+    return 1;
+}
+
+// NOTE(oleh): The unescaped string is never longer than the raw one, so that much is reserved
+// up front and the runs between the escapes are copied over whole. Without an arena the
+// escapes are only checked.
+static b32 JsonUnescape(arena *Arena, string_view Raw, string_view *Out) {
+    const u8 *Ptr = Raw.Items;
+    const u8 *End = Raw.Items + Raw.Count;
+
+    u8 *Result = NULL;
+    uz Count = 0;
+    u8 Discard[4];
+
+    if (Arena != NULL) Result = ArenaEnsure(Arena, AlignForward(Raw.Count, sizeof(uz)));
+
+    while (Ptr < End) {
+        uz Run = ScanFindByte(Ptr, End - Ptr, '\\');
+        if (Result != NULL) memcpy(Result + Count, Ptr, Run);
+        Count += Run;
+        Ptr += Run;
+
+        if (Ptr == End) break;
+
+        uz DecodedCount;
+        uz Consumed = JsonDecodeEscape(Ptr + 1, End, Result != NULL ? Result + Count : Discard, &DecodedCount);
+        if (Consumed == 0) return 0;
+
+        Count += DecodedCount;
+        Ptr += 1 + Consumed;
+    }
+
+    if (Arena != NULL) {
+        Arena->Offset += AlignForward(Count, sizeof(uz));
+        ArenaTrackHighWater(Arena);
+        *Out = (string_view) {.Items = Result, .Count = Count};
+    }
+
+    return 1;
+}
+
+// NOTE(oleh): A parsed document is a flat tape of nodes in document order. Containers are
+// followed by their children, object members are a key node followed by the value. `Next`
+// skips a node together with everything nested in it, so lookups walk the tape instead of
+// chasing pointers. Only objects with many members get a hash index over their keys.
+struct json_node {
+    json_value_type Type;
+    u32 Count;
+    u32 Next;
+    union {
+        f64 Number;
+        string_view String;
+        struct {
+            u32 *Index;
+            u32 IndexMask;
+        };
+    };
+};
+
+typedef struct {
+    json_node *Items;
+    uz Count;
+    uz Capacity;
+} json_tape;
+
+#define JSON_MAX_DEPTH 512
+#define JSON_OBJECT_INDEX_THRESHOLD 16
+
+typedef struct {
+    arena *Arena;
+    // NOTE(oleh): Where unescaped strings go, they outlive the parser.
+    arena *StringArena;
+    string_view Input;
+    uz Position;
+    json_tape Tape;
+} json_parser;
+
+static b32 JsonParseNode(json_parser *Parser, json_token Token, uz Depth) {
+    uz NodeIndex = Parser->Tape.Count;
+
+    json_node Node = {0};
+    Node.Next = 1;
 
     switch (Token.Type) {
     case TOKEN_NUMBER: {
-        f64 NumberValue = ParseF64(Token.Value);
-        OutValue->Type = JSON_NUMBER;
-        OutValue->Number = NumberValue;
-        return 1;
+        Node.Type = JSON_NUMBER;
+        if (!NumberParseF64(Token.Value, &Node.Number)) return 0;
+        break;
     }
     case TOKEN_STRING: {
-        OutValue->Type = JSON_STRING;
-        OutValue->String = Token.Value;
-        return 1;
+        Node.Type = JSON_STRING;
+        Node.String = Token.Value;
+        if (Token.Escaped && !JsonUnescape(Parser->StringArena, Token.Value, &Node.String)) return 0;
+        break;
     }
-    case TOKEN_TRUE: {
-        OutValue->Type = JSON_TRUE;
+    case TOKEN_TRUE: Node.Type = JSON_TRUE; break;
+    case TOKEN_FALSE: Node.Type = JSON_FALSE; break;
+    case TOKEN_NULL: Node.Type = JSON_NULL; break;
+    case TOKEN_LBRACKET:
+    case TOKEN_LBRACE: {
+        if (Depth == JSON_MAX_DEPTH) return 0;
+
+        b32 IsObject = Token.Type == TOKEN_LBRACE;
+        json_token_type ClosingType = IsObject ? TOKEN_RBRACE : TOKEN_RBRACKET;
+
+        Node.Type = IsObject ? JSON_OBJECT : JSON_ARRAY;
+        ARRAY_PUSH(Parser->Arena, &Parser->Tape, Node);
+
+        u32 Count = 0;
+
+        if (!JsonNextToken(Parser->Input, &Parser->Position, &Token)) return 0;
+
+        if (Token.Type != ClosingType) {
+            while (1) {
+                if (IsObject) {
+                    if (Token.Type != TOKEN_STRING) return 0;
+
+                    json_node KeyNode = {.Type = JSON_STRING, .Next = 1, .String = Token.Value};
+                    if (Token.Escaped && !JsonUnescape(Parser->StringArena, Token.Value, &KeyNode.String)) return 0;
+                    ARRAY_PUSH(Parser->Arena, &Parser->Tape, KeyNode);
+
+                    if (!JsonNextToken(Parser->Input, &Parser->Position, &Token)) return 0;
+                    if (Token.Type != TOKEN_COLON) return 0;
+                    if (!JsonNextToken(Parser->Input, &Parser->Position, &Token)) return 0;
+                }
+
+                if (!JsonParseNode(Parser, Token, Depth + 1)) return 0;
+                ++Count;
+
+                if (!JsonNextToken(Parser->Input, &Parser->Position, &Token)) return 0;
+                if (Token.Type == ClosingType) break;
+                if (Token.Type != TOKEN_COMMA) return 0;
+                if (!JsonNextToken(Parser->Input, &Parser->Position, &Token)) return 0;
+            }
+        }
+
+        Parser->Tape.Items[NodeIndex].Count = Count;
+        Parser->Tape.Items[NodeIndex].Next = Parser->Tape.Count - NodeIndex;
         return 1;
     }
-    case TOKEN_FALSE: {
-        OutValue->Type = JSON_FALSE;
-        return 1;
+    default: return 0;
     }
-    case TOKEN_NULL: {
-        OutValue->Type = JSON_NULL;
-        return 1;
+
+    ARRAY_PUSH(Parser->Arena, &Parser->Tape, Node);
+    return 1;
+}
+
+static void JsonIndexObject(arena *Arena, json_node *Object) {
+    u32 IndexCapacity = 1;
+    while (IndexCapacity < 2 * Object->Count) IndexCapacity <<= 1;
+
+    Object->Index = ARENA_PUSH_ZERO(Arena, sizeof(u32) * IndexCapacity);
+    Object->IndexMask = IndexCapacity - 1;
+
+    u32 MemberOffset = 1;
+    for (u32 MemberIndex = 0; MemberIndex < Object->Count; ++MemberIndex) {
+        json_node *Key = Object + MemberOffset;
+
+        u32 Slot = HashFnv1(Key->String) & Object->IndexMask;
+        while (Object->Index[Slot] != 0) {
+            // NOTE(oleh): The first of the duplicate keys wins, same as with the linear scan.
+            if (StringViewEqual(Object[Object->Index[Slot]].String, Key->String)) break;
+            Slot = (Slot + 1) & Object->IndexMask;
+        }
+
+        if (Object->Index[Slot] == 0) Object->Index[Slot] = MemberOffset;
+
+        MemberOffset += 1 + Key[1].Next;
     }
-    case TOKEN_LBRACKET: {
-        json_array Elements;
-        ARRAY_INIT(Arena, &Elements);
+}
 
-        while (1) {
-            if (!JsonPeekToken(Input, Position, &Token)) return 0;
-            if (Token.Type == TOKEN_RBRACKET) {
-                ASSERT(JsonNextToken(Input, Position, &Token));
-                break;
-            }
+static json_value JsonValueFromNode(const json_node *Node) {
+    json_value Value;
+    Value.Type = Node->Type;
+
+    switch (Node->Type) {
+    case JSON_NUMBER: Value.Number = Node->Number; break;
+    case JSON_STRING: Value.String = Node->String; break;
+    case JSON_ARRAY: Value.Array = (json_array) {.Node = Node, .Count = Node->Count}; break;
+    case JSON_OBJECT: Value.Object = (json_object) {.Node = Node, .Count = Node->Count}; break;
+    default: break;
+    }
 
-        ParseElement:
-            json_value Element;
-            if (!JsonParseValue(Arena, Input, Position, &Element)) return 0;
+    return Value;
+}
 
-            ARRAY_PUSH(Arena, &Elements, Element);
+b32 JsonParse(arena *Arena, string_view Input, json_value *OutValue) {
+    // NOTE(oleh): The tape grows in scratch memory where nothing else gets in the way of
+    // the reallocations, only the final one is copied out.
+    scratch_arena Scratch = ScratchBegin(&Arena, 1);
 
-            if (!JsonNextToken(Input, Position, &Token)) return 0;
-            if (Token.Type == TOKEN_RBRACKET) break;
-            if (Token.Type == TOKEN_COMMA) goto ParseElement;
+    json_parser Parser = {0};
+    Parser.Arena = Scratch.Arena;
+    Parser.StringArena = Arena;
+    Parser.Input = Input;
+    ARRAY_INIT(Scratch.Arena, &Parser.Tape);
+
+    json_token Token;
+    b32 Result = JsonNextToken(Input, &Parser.Position, &Token) && JsonParseNode(&Parser, Token, 0);
+
+    // NOTE(oleh): Nothing but whitespace may follow the document.
+    if (Result && JsonNextToken(Input, &Parser.Position, &Token)) Result = 0;
+
+    if (Result) {
+        json_node *Nodes = ArenaPush(Arena, sizeof(json_node) * Parser.Tape.Count);
+        memcpy(Nodes, Parser.Tape.Items, sizeof(json_node) * Parser.Tape.Count);
+
+        for (uz NodeIndex = 0; NodeIndex < Parser.Tape.Count; ++NodeIndex) {
+            json_node *Node = &Nodes[NodeIndex];
+            if (Node->Type == JSON_OBJECT && Node->Count > JSON_OBJECT_INDEX_THRESHOLD) JsonIndexObject(Arena, Node);
         }
 
-        OutValue->Type = JSON_ARRAY;
-        OutValue->Array = Elements;
-        return 1;
+        *OutValue = JsonValueFromNode(Nodes);
     }
-    case TOKEN_LBRACE: {
-        json_object Object;
-        Object.Capacity = DEFAULT_OBJECT_CAPACITY;
-        Object.Keys = ARENA_PUSH_ZERO(Arena, sizeof(*Object.Keys) * DEFAULT_OBJECT_CAPACITY);
-        Object.Values = ARENA_PUSH_ZERO(Arena, sizeof(*Object.Values) * DEFAULT_OBJECT_CAPACITY);
-        Object.Count = 0;
 
-        while (1) {
-            if (!JsonPeekToken(Input, Position, &Token)) return 0;
-            if (Token.Type == TOKEN_RBRACE) {
-                ASSERT(JsonNextToken(Input, Position, &Token));
-                break;
+    ScratchEnd(Scratch);
+    return Result;
+}
+
+b32 JsonObjectGet(const json_object *Object, string_view SearchKey, json_value *OutValue) {
+    const json_node *ObjectNode = Object->Node;
+
+    if (ObjectNode->Index != NULL) {
+        u32 Slot = HashFnv1(SearchKey) & ObjectNode->IndexMask;
+        while (ObjectNode->Index[Slot] != 0) {
+            const json_node *Key = ObjectNode + ObjectNode->Index[Slot];
+            if (StringViewEqual(Key->String, SearchKey)) {
+                *OutValue = JsonValueFromNode(Key + 1);
+                return 1;
             }
 
-        ParseKeyValue:
-            if (!JsonNextToken(Input, Position, &Token)) return 0;
-            if (Token.Type != TOKEN_STRING) return 0;
+            Slot = (Slot + 1) & ObjectNode->IndexMask;
+        }
 
-            string_view KeyToInsert = Token.Value;
+        return 0;
+    }
 
-            if (!JsonNextToken(Input, Position, &Token)) return 0;
-            if (Token.Type != TOKEN_COLON) return 0;
+    const json_node *Key = ObjectNode + 1;
+    for (uz MemberIndex = 0; MemberIndex < Object->Count; ++MemberIndex) {
+        if (StringViewEqual(Key->String, SearchKey)) {
+            *OutValue = JsonValueFromNode(Key + 1);
+            return 1;
+        }
 
-            json_value ValueToInsert;
+        Key += 1 + Key[1].Next;
+    }
 
-            if (!JsonParseValue(Arena, Input, Position, &ValueToInsert)) return 0;
+    return 0;
+}
 
-            uz ObjectLoadPercentage = 100 * Object.Count / Object.Capacity;
+b32 JsonArrayGet(const json_array *Array, uz Index, json_value *OutValue) {
+    if (Index >= Array->Count) return 0;
 
-            if (ObjectLoadPercentage >= 65) {
-                uz NewCapacity = (Object.Capacity + 1) * 3;
-                Object.Keys = ArenaRealloc(Arena, Object.Keys, Object.Capacity * sizeof(*Object.Keys), NewCapacity * sizeof(*Object.Keys));
-                Object.Values = ArenaRealloc(Arena, Object.Values, Object.Capacity * sizeof(*Object.Values), NewCapacity * sizeof(*Object.Values));
-                Object.Capacity = NewCapacity;
-            }
+    const json_node *Element = Array->Node + 1;
+    for (uz ElementIndex = 0; ElementIndex < Index; ++ElementIndex) Element += Element->Next;
 
-            u64 ObjectIndex = HashFnv1(KeyToInsert) % Object.Capacity;
+    *OutValue = JsonValueFromNode(Element);
+    return 1;
+}
 
-            while (1) {
-                string_view CurrentKey = Object.Keys[ObjectIndex];
-                if (CurrentKey.Items == NULL) {
-                    Object.Keys[ObjectIndex] = KeyToInsert;
-                    Object.Values[ObjectIndex] = ValueToInsert;
-                    ++Object.Count;
-                    break;
-                }
+json_array_iterator JsonArrayIterate(const json_array *Array) {
+    return (json_array_iterator) {.Node = Array->Node + 1, .Remaining = Array->Count};
+}
 
-                if (StringViewEqual(CurrentKey, KeyToInsert)) {
-                    PANIC_FMT("Tried to insert a duplicate key '" SV_FMT "' into an object", SV_ARG(KeyToInsert));
-                }
+b32 JsonArrayNext(json_array_iterator *Iterator, json_value *OutValue) {
+    if (Iterator->Remaining == 0) return 0;
 
-                ++ObjectIndex;
-                if (ObjectIndex >= Object.Capacity) ObjectIndex = 0;
+    *OutValue = JsonValueFromNode(Iterator->Node);
+
+    // NOTE(oleh): The last element may not have a sibling to point at.
+    if (--Iterator->Remaining != 0) Iterator->Node += Iterator->Node->Next;
+    return 1;
+}
+
+#define X(Type)                                                         \
+    b32 JsonObjectGet_##Type(const json_object *Object, string_view Key, Type *OutValue) { \
+        json_value JsonValue;                                           \
+        if (!JsonObjectGet(Object, Key, &JsonValue)) return 0;          \
+        return JsonDecode_##Type(&JsonValue, OutValue);                 \
+    }
+ENUM_JSON_GETTERS
+#undef X
+
+// NOTE(oleh): Skips the rest of a container whose opening token was already consumed, `Depth`
+// being where it sits in the document. Nothing is kept, but everything is checked the same
+// way `JsonParseNode` checks it, so decoding accepts exactly the documents parsing does.
+static b32 JsonSkipContainer(string_view Input, uz *Position, b32 IsObject, uz Depth) {
+    // NOTE(oleh): A bit per open container, set for objects.
+    u64 Objects[JSON_MAX_DEPTH / 64] = {0};
+#define JSON_SKIP_SET_OBJECT(Depth) (Objects[(Depth) / 64] |= (u64)1 << ((Depth) % 64))
+#define JSON_SKIP_IS_OBJECT(Depth) ((Objects[(Depth) / 64] >> ((Depth) % 64)) & 1)
+
+    uz BaseDepth = Depth;
+    if (IsObject) JSON_SKIP_SET_OBJECT(Depth);
+
+    b32 JustOpened = 1;
+    json_token Token;
+
+    while (1) {
+        if (!JsonNextToken(Input, Position, &Token)) return 0;
+
+        b32 InObject = JSON_SKIP_IS_OBJECT(Depth);
+        b32 Closed = JustOpened && Token.Type == (InObject ? TOKEN_RBRACE : TOKEN_RBRACKET);
+
+        if (!Closed) {
+            if (InObject) {
+                if (Token.Type != TOKEN_STRING) return 0;
+                if (Token.Escaped && !JsonUnescape(NULL, Token.Value, NULL)) return 0;
+
+                if (!JsonNextToken(Input, Position, &Token)) return 0;
+                if (Token.Type != TOKEN_COLON) return 0;
+                if (!JsonNextToken(Input, Position, &Token)) return 0;
+            }
+
+            switch (Token.Type) {
+            case TOKEN_LBRACKET:
+            case TOKEN_LBRACE: {
+                if (Depth + 1 == JSON_MAX_DEPTH) return 0;
+                ++Depth;
+                Objects[Depth / 64] &= ~((u64)1 << (Depth % 64));
+                if (Token.Type == TOKEN_LBRACE) JSON_SKIP_SET_OBJECT(Depth);
+                JustOpened = 1;
+                continue;
+            }
+            case TOKEN_NUMBER: {
+                f64 Discard;
+                if (!NumberParseF64(Token.Value, &Discard)) return 0;
+                break;
+            }
+            case TOKEN_STRING: {
+                if (Token.Escaped && !JsonUnescape(NULL, Token.Value, NULL)) return 0;
+                break;
+            }
+            case TOKEN_TRUE:
+            case TOKEN_FALSE:
+            case TOKEN_NULL: break;
+            default: return 0;
+            }
+        }
+
+        // NOTE(oleh): A value is done, next comes either a comma or the end of one or more containers.
+        while (1) {
+            if (Closed) {
+                if (Depth == BaseDepth) return 1;
+                --Depth;
             }
 
             if (!JsonNextToken(Input, Position, &Token)) return 0;
-            if (Token.Type == TOKEN_RBRACE) break;
-            if (Token.Type == TOKEN_COMMA) goto ParseKeyValue;
+            if (Token.Type == TOKEN_COMMA) break;
+            if (Token.Type != (JSON_SKIP_IS_OBJECT(Depth) ? TOKEN_RBRACE : TOKEN_RBRACKET)) return 0;
+            Closed = 1;
         }
 
+        JustOpened = 0;
+    }
+
+#undef JSON_SKIP_SET_OBJECT
+#undef JSON_SKIP_IS_OBJECT
+}
+
+// NOTE(oleh): Without an arena the value is only checked, that is how unknown keys are skipped.
+// `Depth` is the depth a container value would have in the document.
+static b32 JsonDecodeValue(arena *Arena, string_view Input, uz *Position, uz Depth, json_value *OutValue) {
+    json_token Token;
+    if (!JsonNextToken(Input, Position, &Token)) return 0;
+
+    switch (Token.Type) {
+    case TOKEN_NUMBER: {
+        OutValue->Type = JSON_NUMBER;
+        return NumberParseF64(Token.Value, &OutValue->Number);
+    }
+    case TOKEN_STRING: {
+        OutValue->Type = JSON_STRING;
+        OutValue->String = Token.Value;
+        return !Token.Escaped || JsonUnescape(Arena, Token.Value, &OutValue->String);
+    }
+    case TOKEN_TRUE: OutValue->Type = JSON_TRUE; return 1;
+    case TOKEN_FALSE: OutValue->Type = JSON_FALSE; return 1;
+    case TOKEN_NULL: OutValue->Type = JSON_NULL; return 1;
+    case TOKEN_LBRACKET: {
+        OutValue->Type = JSON_ARRAY;
+        OutValue->Array = (json_array) {0};
+        return JsonSkipContainer(Input, Position, 0, Depth);
+    }
+    case TOKEN_LBRACE: {
         OutValue->Type = JSON_OBJECT;
-        OutValue->Object = Object;
-        return 1;
+        OutValue->Object = (json_object) {0};
+        return JsonSkipContainer(Input, Position, 1, Depth);
     }
-    default: TODO();
+    default: return 0;
     }
 }
 
-b32 JsonParse(arena *Arena, string_view Input, json_value *OutValue) {
+b32 JsonDecodeObject(arena *Arena, string_view Input, const json_field *Fields, uz FieldsCount, void *Out) {
+    ASSERT(FieldsCount <= 64);
+
+    // NOTE(oleh): Escaped keys are unescaped into here only to be compared.
+    scratch_arena Scratch = ScratchBegin(&Arena, 1);
+    b32 Result = 0;
+
+    u64 SeenFields = 0;
     uz Position = 0;
-    return JsonParseValue(Arena, Input, &Position, OutValue);
-}
+    json_token Token;
 
-b32 JsonObjectGet(const json_object *Object, string_view SearchKey, json_value *OutValue) {
-    u64 StartIndex = HashFnv1(SearchKey) % Object->Capacity;
-    u64 CurrentIndex = StartIndex;
+    if (!JsonNextToken(Input, &Position, &Token)) goto Cleanup;
+    if (Token.Type != TOKEN_LBRACE) goto Cleanup;
 
-    do {
-        string_view CurrentKey = Object->Keys[CurrentIndex];
-        if (CurrentKey.Items != NULL && StringViewEqual(CurrentKey, SearchKey)) {
-            *OutValue = Object->Values[CurrentIndex];
-            return 1;
+    if (!JsonNextToken(Input, &Position, &Token)) goto Cleanup;
+
+    if (Token.Type != TOKEN_RBRACE) {
+        while (1) {
+            if (Token.Type != TOKEN_STRING) goto Cleanup;
+
+            string_view Key = Token.Value;
+            if (Token.Escaped && !JsonUnescape(Scratch.Arena, Token.Value, &Key)) goto Cleanup;
+
+            if (!JsonNextToken(Input, &Position, &Token)) goto Cleanup;
+            if (Token.Type != TOKEN_COLON) goto Cleanup;
+
+            const json_field *Field = NULL;
+            for (uz FieldIndex = 0; FieldIndex < FieldsCount; ++FieldIndex) {
+                if (!StringViewEqual(Fields[FieldIndex].Name, Key)) continue;
+
+                // NOTE(oleh): The first of the duplicate keys wins, same as with `JsonObjectGet`.
+                u64 FieldBit = (u64)1 << FieldIndex;
+                if (!(SeenFields & FieldBit)) {
+                    SeenFields |= FieldBit;
+                    Field = &Fields[FieldIndex];
+                }
+                break;
+            }
+
+            json_value Value;
+            if (!JsonDecodeValue(Field != NULL ? Arena : NULL, Input, &Position, 1, &Value)) goto Cleanup;
+            if (Field != NULL && !Field->Decode(&Value, (u8 *)Out + Field->Offset)) goto Cleanup;
+
+            if (!JsonNextToken(Input, &Position, &Token)) goto Cleanup;
+            if (Token.Type == TOKEN_RBRACE) break;
+            if (Token.Type != TOKEN_COMMA) goto Cleanup;
+            if (!JsonNextToken(Input, &Position, &Token)) goto Cleanup;
         }
+    }
+
+    if (JsonNextToken(Input, &Position, &Token)) goto Cleanup;
 
-        ++CurrentIndex;
+    for (uz FieldIndex = 0; FieldIndex < FieldsCount; ++FieldIndex) {
+        if (SeenFields & ((u64)1 << FieldIndex)) continue;
+        if (!Fields[FieldIndex].Decode(NULL, (u8 *)Out + Fields[FieldIndex].Offset)) goto Cleanup;
+    }
 
-        if (CurrentIndex >= Object->Capacity) CurrentIndex = 0;
-    } while (CurrentIndex != StartIndex);
+    Result = 1;
 
-    return 0;
+Cleanup:
+    ScratchEnd(Scratch);
+    return Result;
+}
+
+b32 JsonDecode_string_view(const json_value *Value, void *Out) {
+    if (Value == NULL || Value->Type != JSON_STRING) return 0;
+    *(string_view *)Out = Value->String;
+    return 1;
 }
 
-b32 JsonObjectGet_string_view(const json_object *Object, string_view Key, string_view *OutValue) {
-    json_value JsonValue;
-    if (!JsonObjectGet(Object, Key, &JsonValue)) return 0;
-    if (JsonValue.Type != JSON_STRING) return 0;
-    *OutValue = JsonValue.String;
+b32 JsonDecode_f64(const json_value *Value, void *Out) {
+    if (Value == NULL || Value->Type != JSON_NUMBER) return 0;
+    *(f64 *)Out = Value->Number;
     return 1;
 }
 
-static arena *CurrentJsonArena;
-static uz CurrentJsonStart;
+static b32 JsonDecodeInteger(const json_value *Value, f64 Limit, u64 *Out) {
+    if (Value == NULL || Value->Type != JSON_NUMBER) return 0;
 
-enum {
-    STATE_CLEAN,
-    STATE_DIRTY,
-} CurrentJsonState;
+    f64 Number = Value->Number;
+    if (!(Number >= 0 && Number < Limit)) return 0;
+    if ((f64)(u64)Number != Number) return 0;
 
-void JsonBegin(arena *Arena) {
-    CurrentJsonArena = Arena;
-    CurrentJsonStart = Arena->Offset;
-    CurrentJsonState = STATE_CLEAN;
+    *Out = (u64)Number;
+    return 1;
 }
 
-string_view JsonEnd(void) {
-    uz JsonCount = CurrentJsonArena->Offset - CurrentJsonStart;
-    string_view Result = {.Items = CurrentJsonArena->Items + CurrentJsonStart, .Count = JsonCount};
-    CurrentJsonArena->Offset = AlignForward(CurrentJsonArena->Offset, sizeof(uz));
-    return Result;
+b32 JsonDecode_u64(const json_value *Value, void *Out) {
+    return JsonDecodeInteger(Value, 18446744073709551616.0, Out);
 }
 
-void JsonBeginObject(void) {
-    ASSERT(CurrentJsonArena->Capacity - CurrentJsonArena->Offset >= 1);
-    u8 *Ptr = CurrentJsonArena->Items + CurrentJsonArena->Offset;
-    *Ptr = '{';
-    CurrentJsonArena->Offset += 1;
-    CurrentJsonState = STATE_CLEAN;
+b32 JsonDecode_u32(const json_value *Value, void *Out) {
+    u64 Integer;
+    if (!JsonDecodeInteger(Value, 4294967296.0, &Integer)) return 0;
+    *(u32 *)Out = (u32)Integer;
+    return 1;
 }
 
-void JsonEndObject(void) {
-    ASSERT(CurrentJsonArena->Capacity - CurrentJsonArena->Offset >= 1);
-    u8 *Ptr = CurrentJsonArena->Items + CurrentJsonArena->Offset;
-    *Ptr = '}';
-    CurrentJsonArena->Offset += 1;
-    CurrentJsonState = STATE_DIRTY;
+// NOTE(oleh): A missing key and an explicit null both leave the value unset.
+#define X(ValueType)                                                    \
+    b32 JsonDecode_optional_##ValueType(const json_value *Value, void *Out) { \
+        optional_##ValueType *Optional = Out;                           \
+        Optional->HasValue = Value != NULL && Value->Type != JSON_NULL; \
+        if (!Optional->HasValue) return 1;                              \
+        return JsonDecode_##ValueType(Value, &Optional->Value);         \
+    }
+ENUM_JSON_GETTERS
+#undef X
+
+void JsonWriterInitArena(json_writer *Writer, arena *Arena) {
+    STRUCT_ZERO(Writer);
+    Writer->Arena = Arena;
+    Writer->Start = Arena->Offset;
 }
 
-void JsonBeginArray(void) {
-    ASSERT(CurrentJsonArena->Capacity - CurrentJsonArena->Offset >= 1);
-    u8 *Ptr = CurrentJsonArena->Items + CurrentJsonArena->Offset;
-    *Ptr = '[';
-    CurrentJsonArena->Offset += 1;
-    CurrentJsonState = STATE_CLEAN;
+void JsonWriterInitBuffer(json_writer *Writer, u8 *Buffer, uz Capacity, json_writer_flush Flush, void *UserData) {
+    ASSERT(Capacity >= JSON_WRITER_MIN_BUFFER_SIZE);
+
+    STRUCT_ZERO(Writer);
+    Writer->Buffer = Buffer;
+    Writer->Capacity = Capacity;
+    Writer->Flush = Flush;
+    Writer->FlushUserData = UserData;
 }
 
-void JsonEndArray(void) {
-    ASSERT(CurrentJsonArena->Capacity - CurrentJsonArena->Offset >= 1);
-    u8 *Ptr = CurrentJsonArena->Items + CurrentJsonArena->Offset;
-    *Ptr = ']';
-    CurrentJsonArena->Offset += 1;
-    CurrentJsonState = STATE_DIRTY;
+uz JsonWriterPendingCount(const json_writer *Writer) {
+    if (Writer->Arena != NULL) return Writer->Arena->Offset - Writer->Start;
+    return Writer->Count;
 }
 
-void JsonPutKey(string_view Key) {
-    uz BytesRequired;
+b32 JsonWriterFlush(json_writer *Writer) {
+    ASSERT(Writer->Arena == NULL);
 
-    if (CurrentJsonState == STATE_CLEAN) {
-        BytesRequired = Key.Count + 3;
+    if (Writer->Count != 0 && !Writer->Failed) {
+        string_view Bytes = {.Items = Writer->Buffer, .Count = Writer->Count};
+        if (!Writer->Flush(Writer->FlushUserData, Bytes)) Writer->Failed = 1;
+    }
 
-        ASSERT(CurrentJsonArena->Capacity - CurrentJsonArena->Offset >= BytesRequired);
+    Writer->Count = 0;
+    return !Writer->Failed;
+}
+
+string_view JsonWriterEnd(json_writer *Writer) {
+    if (Writer->Arena == NULL) return (string_view) {.Items = Writer->Buffer, .Count = Writer->Count};
+
+    arena *Arena = Writer->Arena;
+    string_view Result = {.Items = Arena->Items + Writer->Start, .Count = Arena->Offset - Writer->Start};
+    Arena->Offset = AlignForward(Arena->Offset, sizeof(uz));
+    ArenaTrackHighWater(Arena);
+    return Result;
+}
+
+// NOTE(oleh): Room for `Size` bytes at the end of the output, which has to be no more than
+// `JSON_WRITER_MIN_BUFFER_SIZE`. `JsonWriterCommit` makes them part of the output.
+static u8 *JsonWriterReserve(json_writer *Writer, uz Size) {
+    if (Writer->Arena != NULL) return ArenaEnsure(Writer->Arena, Size);
 
-        u8 *Ptr = CurrentJsonArena->Items + CurrentJsonArena->Offset;
-        *Ptr = '"';
-        memcpy(Ptr + 1, Key.Items, Key.Count);
-        Ptr[Key.Count + 1] = '"';
-        Ptr[Key.Count + 2] = ':';
-    } else {
-        BytesRequired = Key.Count + 4;
+    if (Writer->Count + Size > Writer->Capacity) JsonWriterFlush(Writer);
+    return Writer->Buffer + Writer->Count;
+}
 
-        ASSERT(CurrentJsonArena->Capacity - CurrentJsonArena->Offset >= BytesRequired);
+static inline void JsonWriterCommit(json_writer *Writer, uz Size) {
+    if (Writer->Arena != NULL) Writer->Arena->Offset += Size;
+    else Writer->Count += Size;
+}
 
-        u8 *Ptr = CurrentJsonArena->Items + CurrentJsonArena->Offset;
-        *Ptr = ',';
-        Ptr[1] = '"';
-        memcpy(Ptr + 2, Key.Items, Key.Count);
-        Ptr[Key.Count + 2] = '"';
-        Ptr[Key.Count + 3] = ':';
+static void JsonWriterWriteBytes(json_writer *Writer, const u8 *Bytes, uz Count) {
+    if (Writer->Arena != NULL) {
+        memcpy(ArenaEnsure(Writer->Arena, Count), Bytes, Count);
+        Writer->Arena->Offset += Count;
+        return;
     }
 
-    CurrentJsonArena->Offset += BytesRequired;
+    while (Count != 0) {
+        if (Writer->Count == Writer->Capacity) JsonWriterFlush(Writer);
+
+        uz Piece = Writer->Capacity - Writer->Count;
+        if (Piece > Count) Piece = Count;
+
+        memcpy(Writer->Buffer + Writer->Count, Bytes, Piece);
+        Writer->Count += Piece;
+        Bytes += Piece;
+        Count -= Piece;
+    }
+}
+
+static inline void JsonWriterWriteByte(json_writer *Writer, u8 Byte) {
+    *JsonWriterReserve(Writer, 1) = Byte;
+    JsonWriterCommit(Writer, 1);
+}
+
+static inline u64 JsonWriterLevelBit(const json_writer *Writer) {
+    return (u64)1 << (Writer->Depth - 1);
+}
+
+// NOTE(oleh): Puts the comma in front of every array element but the first one. Object members
+// got theirs in front of the key.
+static void JsonWriterBeginValue(json_writer *Writer) {
+    if (Writer->AfterKey) {
+        Writer->AfterKey = 0;
+        return;
+    }
+
+    if (Writer->Depth == 0) return;
+
+    u64 LevelBit = JsonWriterLevelBit(Writer);
+    ASSERT(!(Writer->InObject & LevelBit));
+
+    if (Writer->HasElements & LevelBit) JsonWriterWriteByte(Writer, ',');
+    Writer->HasElements |= LevelBit;
 }
 
-void JsonPutString(string_view String) {
-    uz BytesRequired = String.Count + 2;
-    ASSERT(CurrentJsonArena->Capacity - CurrentJsonArena->Offset >= BytesRequired);
+static void JsonWriterPush(json_writer *Writer, b32 IsObject, u8 Opening) {
+    JsonWriterBeginValue(Writer);
+    JsonWriterWriteByte(Writer, Opening);
 
-    u8 *Ptr = CurrentJsonArena->Items + CurrentJsonArena->Offset;
-    Ptr[0] = '"';
-    memcpy(Ptr + 1, String.Items, String.Count);
-    Ptr[String.Count + 1] = '"';
+    ASSERT(Writer->Depth < JSON_WRITER_MAX_DEPTH);
+    ++Writer->Depth;
 
-    CurrentJsonState = STATE_DIRTY;
-    CurrentJsonArena->Offset += BytesRequired;
+    u64 LevelBit = JsonWriterLevelBit(Writer);
+    Writer->HasElements &= ~LevelBit;
+    if (IsObject) Writer->InObject |= LevelBit;
+    else Writer->InObject &= ~LevelBit;
 }
 
-void JsonPrepareArrayElement(void) {
-    if (CurrentJsonState == STATE_DIRTY) {
-        const uz BytesRequired = 1;
+static void JsonWriterPop(json_writer *Writer, b32 IsObject, u8 Closing) {
+    ASSERT(Writer->Depth != 0 && !Writer->AfterKey);
+    ASSERT(!!(Writer->InObject & JsonWriterLevelBit(Writer)) == !!IsObject);
+
+    --Writer->Depth;
+    JsonWriterWriteByte(Writer, Closing);
+}
 
-        ASSERT(CurrentJsonArena->Capacity - CurrentJsonArena->Offset >= BytesRequired);
+void JsonBeginObject(json_writer *Writer) {
+    JsonWriterPush(Writer, 1, '{');
+}
 
-        u8 *Ptr = CurrentJsonArena->Items + CurrentJsonArena->Offset;
-        *Ptr = ',';
-        CurrentJsonArena->Offset += BytesRequired;
+void JsonEndObject(json_writer *Writer) {
+    JsonWriterPop(Writer, 1, '}');
+}
+
+void JsonBeginArray(json_writer *Writer) {
+    JsonWriterPush(Writer, 0, '[');
+}
+
+void JsonEndArray(json_writer *Writer) {
+    JsonWriterPop(Writer, 0, ']');
+}
+
+static const u8 JsonHexDigits[] = "0123456789abcdef";
+
+// NOTE(oleh): Writes `String` between quotes. Runs that need no escaping are found 16 to 32 bytes
+// at a time and copied over whole, the escapes themselves take at most 6 bytes each.
+static void JsonWriterWriteQuoted(json_writer *Writer, string_view String) {
+    JsonWriterWriteByte(Writer, '"');
+
+    uz Position = 0;
+    while (1) {
+        uz Run = ScanFindJsonStringSpecial(String.Items + Position, String.Count - Position);
+        JsonWriterWriteBytes(Writer, String.Items + Position, Run);
+        Position += Run;
+
+        if (Position == String.Count) break;
+
+        u8 Char = String.Items[Position++];
+        u8 *Ptr = JsonWriterReserve(Writer, 6);
+        u8 *EscapeStart = Ptr;
+        *Ptr++ = '\\';
+
+        switch (Char) {
+        case '"': *Ptr++ = '"'; break;
+        case '\\': *Ptr++ = '\\'; break;
+        case '\b': *Ptr++ = 'b'; break;
+        case '\f': *Ptr++ = 'f'; break;
+        case '\n': *Ptr++ = 'n'; break;
+        case '\r': *Ptr++ = 'r'; break;
+        case '\t': *Ptr++ = 't'; break;
+        default: {
+            *Ptr++ = 'u';
+            *Ptr++ = '0';
+            *Ptr++ = '0';
+            *Ptr++ = JsonHexDigits[Char >> 4];
+            *Ptr++ = JsonHexDigits[Char & 0xF];
+            break;
+        }
+        }
+
+        JsonWriterCommit(Writer, Ptr - EscapeStart);
     }
+
+    JsonWriterWriteByte(Writer, '"');
+}
+
+void JsonPutKey(json_writer *Writer, string_view Key) {
+    ASSERT(Writer->Depth != 0 && !Writer->AfterKey);
+
+    u64 LevelBit = JsonWriterLevelBit(Writer);
+    ASSERT(Writer->InObject & LevelBit);
+
+    if (Writer->HasElements & LevelBit) JsonWriterWriteByte(Writer, ',');
+    Writer->HasElements |= LevelBit;
+
+    JsonWriterWriteQuoted(Writer, Key);
+    JsonWriterWriteByte(Writer, ':');
+    Writer->AfterKey = 1;
+}
+
+void JsonPutString(json_writer *Writer, string_view String) {
+    JsonWriterBeginValue(Writer);
+    JsonWriterWriteQuoted(Writer, String);
+}
+
+void JsonPutNumber(json_writer *Writer, f64 Number) {
+    JsonWriterBeginValue(Writer);
+    u8 *Ptr = JsonWriterReserve(Writer, NUMBER_F64_MAX_CHARS);
+    JsonWriterCommit(Writer, NumberFormatF64(Number, Ptr));
+}
+
+void JsonPutU64(json_writer *Writer, u64 Number) {
+    JsonWriterBeginValue(Writer);
+    u8 *Ptr = JsonWriterReserve(Writer, NUMBER_U64_MAX_CHARS);
+    JsonWriterCommit(Writer, NumberFormatU64(Number, Ptr));
+}
+
+void JsonPutTrue(json_writer *Writer) {
+    JsonWriterBeginValue(Writer);
+    JsonWriterWriteBytes(Writer, (const u8 *)"true", 4);
+}
+
+void JsonPutFalse(json_writer *Writer) {
+    JsonWriterBeginValue(Writer);
+    JsonWriterWriteBytes(Writer, (const u8 *)"false", 5);
+}
+
+void JsonPutNull(json_writer *Writer) {
+    JsonWriterBeginValue(Writer);
+    JsonWriterWriteBytes(Writer, (const u8 *)"null", 4);
+}
+
+void JsonPutRaw(json_writer *Writer, string_view Json) {
+    JsonWriterBeginValue(Writer);
+    JsonWriterWriteBytes(Writer, Json.Items, Json.Count);
 }
@@ -16,17 +16,18 @@ typedef enum {
 struct json_value;
 typedef struct json_value json_value;
 
+struct json_node;
+typedef struct json_node json_node;
+
+// NOTE(oleh): Arrays and objects are views into the tape of a parsed document.
 typedef struct {
-    json_value *Items;
+    const json_node *Node;
     uz Count;
-    uz Capacity;
 } json_array;
 
 typedef struct {
-    string_view *Keys;
-    json_value *Values;
+    const json_node *Node;
     uz Count;
-    uz Capacity;
 } json_object;
 
 struct json_value {
@@ -39,15 +40,29 @@ struct json_value {
     };
 };
 
+// NOTE(oleh): Strings without escapes point into `Input`, the rest are unescaped into `Arena`.
 b32 JsonParse(arena *Arena, string_view Input, json_value *OutValue);
 
+// NOTE(oleh): If a key shows up more than once, the first one wins.
 b32 JsonObjectGet(const json_object *Object, string_view Key, json_value *OutValue);
+b32 JsonArrayGet(const json_array *Array, uz Index, json_value *OutValue);
 
+// NOTE(oleh): Goes over the elements in order, `JsonArrayGet` has to skip all the preceding ones every time.
+typedef struct {
+    const json_node *Node;
+    uz Remaining;
+} json_array_iterator;
+
+json_array_iterator JsonArrayIterate(const json_array *Array);
+b32 JsonArrayNext(json_array_iterator *Iterator, json_value *OutValue);
+
+// NOTE(oleh): Integers have to be whole and in range. Numbers are doubles, so anything past
+// 2^53 arrives rounded to the nearest one.
 #define ENUM_JSON_GETTERS \
     X(string_view) \
-        X(f64) \
-        X(u64) \
-        X(u32)
+    X(f64) \
+    X(u64) \
+    X(u32)
 
 #define X(Type) b32 JsonObjectGet_##Type(const json_object *Object, string_view Key, Type *OutValue);
 ENUM_JSON_GETTERS
@@ -63,29 +78,100 @@ ENUM_JSON_GETTERS
 ENUM_JSON_GETTERS
 #undef X
 
-void JsonBegin(arena *);
-
-void JsonBeginObject(void);
-void JsonEndObject(void);
+// NOTE(oleh): Decodes an object with a known set of fields in a single pass over `Input`,
+// straight into the struct at `Out`, without building a tape. Values of unknown keys are
+// skipped without allocating. Strings point into `Input` unless they had escapes, those are
+// unescaped into `Arena`. A decoder gets a NULL `Value` if its key is missing and gets a
+// container value without a view into it, it only learns its type.
+typedef b32 (*json_field_decoder)(const json_value *Value, void *Out);
 
-void JsonBeginArray(void);
-void JsonEndArray(void);
+typedef struct {
+    string_view Name;
+    json_field_decoder Decode;
+    uz Offset;
+} json_field;
+
+#define JSON_FIELD(Struct, Type, Field) {                               \
+        .Name = {.Items = (u8 *)#Field, .Count = sizeof(#Field) - 1},   \
+        .Decode = JsonDecode_##Type,                                    \
+        .Offset = offsetof(Struct, Field),                              \
+    },
+
+b32 JsonDecodeObject(arena *Arena, string_view Input, const json_field *Fields, uz FieldsCount, void *Out);
+
+#define X(Type)                                                         \
+    b32 JsonDecode_##Type(const json_value *Value, void *Out);          \
+    b32 JsonDecode_optional_##Type(const json_value *Value, void *Out);
+ENUM_JSON_GETTERS
+#undef X
 
-void JsonPrepareArrayElement(void);
+// NOTE(oleh): A writer holds everything about the document it is producing, so any number of them
+// can be in flight on any threads. Commas are placed by the writer, it tracks at every level of
+// nesting whether an element was written already.
+//
+// An arena writer appends to the arena and `JsonWriterEnd` hands out the whole document. A buffer
+// writer never takes more memory than its buffer: whenever that fills up, the bytes are passed to
+// `Flush` and the buffer is reused. After a failed flush everything written is dropped and `Failed`
+// stays set, so a producer can bail out early.
 
-void JsonPutNumber(f64);
-void JsonPutString(string_view);
+#define JSON_WRITER_MAX_DEPTH 64
+#define JSON_WRITER_MIN_BUFFER_SIZE 64
 
-void JsonPutTrue(void);
-void JsonPutFalse(void);
-void JsonPutNull(void);
+typedef b32 (*json_writer_flush)(void *UserData, string_view Bytes);
 
-void JsonPutKey(string_view);
+typedef struct {
+    arena *Arena;
+    uz Start;
 
-string_view JsonEnd(void);
+    u8 *Buffer;
+    uz Capacity;
+    uz Count;
+    json_writer_flush Flush;
+    void *FlushUserData;
+    b32 Failed;
+
+    // NOTE(oleh): One bit per level of nesting.
+    u64 InObject;
+    u64 HasElements;
+    u32 Depth;
+    b32 AfterKey;
+} json_writer;
+
+void JsonWriterInitArena(json_writer *, arena *);
+void JsonWriterInitBuffer(json_writer *, u8 *Buffer, uz Capacity, json_writer_flush Flush, void *UserData);
+
+void JsonBeginObject(json_writer *);
+void JsonEndObject(json_writer *);
+
+void JsonBeginArray(json_writer *);
+void JsonEndArray(json_writer *);
+
+void JsonPutNumber(json_writer *, f64);
+// NOTE(oleh): Exact for the whole range, unlike going through a double.
+void JsonPutU64(json_writer *, u64);
+void JsonPutString(json_writer *, string_view);
+
+void JsonPutTrue(json_writer *);
+void JsonPutFalse(json_writer *);
+void JsonPutNull(json_writer *);
+// NOTE(oleh): Writes an already serialized value as is, it is not checked.
+void JsonPutRaw(json_writer *, string_view Json);
+
+void JsonPutKey(json_writer *, string_view);
+
+// NOTE(oleh): Bytes written and not flushed yet.
+uz JsonWriterPendingCount(const json_writer *);
+// NOTE(oleh): Only for buffer writers, returns 0 if the flush failed now or earlier.
+b32 JsonWriterFlush(json_writer *);
+// NOTE(oleh): Everything written and not flushed. For an arena writer that is the whole document,
+// for a buffer writer the view is only valid until the buffer is written to again.
+string_view JsonWriterEnd(json_writer *);
 
 // Aliases for entity-type serializers.
 
 #define JsonPut_string_view JsonPutString
+#define JsonPut_f64 JsonPutNumber
+#define JsonPut_u64 JsonPutU64
+#define JsonPut_u32 JsonPutU64
 
 #endif // JSON_H_
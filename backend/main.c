@@ -5,10 +5,14 @@
 #include "http.h"
 #include "db.h"
 #include "json.h"
+#include "cache.h"
+#include "schema.h"
+#include "scan.h"
+#include "metrics.h"
 
-#define HANDLER(Name) static http_response_status Name(http_response_context *Context)
+#define HTTP_WORKERS_COUNT_VAR "HTTP_WORKERS_COUNT"
 
-#define DEFAULT_JSON_DESERIALIZER(Json, Object, Type, Field) if (!JsonObjectGet_##Type((Json), SV_LIT(#Field), &(Object)->Field)) return HTTP_STATUS_BAD_REQUEST;
+#define HANDLER(Name) static http_response_status Name(http_response_context *Context)
 
 HANDLER(IndexHandler) {
     Context->Content = SV_LIT("HELLO");
@@ -16,37 +20,22 @@ HANDLER(IndexHandler) {
 }
 
 HANDLER(InsertProjectHandler) {
-    if (Context->Request.Method != HTTP_POST) return HTTP_STATUS_METHOD_NOT_ALLOWED;
-
-    json_value JsonPayloadValue;
-    if (!JsonParse(Context->Arena, Context->Request.Body, &JsonPayloadValue)) return HTTP_STATUS_BAD_REQUEST;
-    if (JsonPayloadValue.Type != JSON_OBJECT) return HTTP_STATUS_BAD_REQUEST;
-
-    json_object JsonPayload = JsonPayloadValue.Object;
-
     project_entity Project;
+    if (!SchemaDecode_project_entity(Context->Arena, Context->Request.Body, &Project)) return HTTP_STATUS_BAD_REQUEST;
 
-#define X(Type, Field) DEFAULT_JSON_DESERIALIZER(&JsonPayload, &Project, Type, Field)
-DECLARE_PROJECT_ENTITY
-#undef X
+    switch (DbInsertProject(&Project)) {
+    case DB_INSERT_OK: return HTTP_STATUS_OK;
+    case DB_INSERT_DUPLICATE:
+    case DB_INSERT_DUPLICATE_ID: return HTTP_STATUS_CONFLICT;
+    case DB_INSERT_FAILED: return HTTP_STATUS_INTERNAL_SERVER_ERROR;
+    }
 
-    if (!DbInsertProject(&Project)) return HTTP_STATUS_INTERNAL_SERVER_ERROR;
-    return HTTP_STATUS_OK;
+    UNREACHABLE();
 }
 
 HANDLER(UpdateProjectHandler) {
-    if (Context->Request.Method != HTTP_POST) return HTTP_STATUS_METHOD_NOT_ALLOWED;
-
-    json_value JsonPayloadValue;
-    if (!JsonParse(Context->Arena, Context->Request.Body, &JsonPayloadValue)) return HTTP_STATUS_BAD_REQUEST;
-    if (JsonPayloadValue.Type != JSON_OBJECT) return HTTP_STATUS_BAD_REQUEST;
-
-    json_object JsonPayload = JsonPayloadValue.Object;
-
     project_update_entity Update;
-#define X(Type, Field) DEFAULT_JSON_DESERIALIZER(&JsonPayload, &Update, Type, Field)
-DECLARE_PROJECT_UPDATE_ENTITY
-#undef X
+    if (!SchemaDecode_project_update_entity(Context->Arena, Context->Request.Body, &Update)) return HTTP_STATUS_BAD_REQUEST;
 
     if (!DbUpdateProject(&Update)) return HTTP_STATUS_INTERNAL_SERVER_ERROR;
 
@@ -54,8 +43,6 @@ DECLARE_PROJECT_UPDATE_ENTITY
 }
 
 HANDLER(DeleteProjectHandler) {
-    if (Context->Request.Method != HTTP_POST) return HTTP_STATUS_METHOD_NOT_ALLOWED;
-
     string_view ProjectId = Context->Request.Body;
     if (ProjectId.Count == 0) return HTTP_STATUS_BAD_REQUEST;
 
@@ -67,170 +54,604 @@ HANDLER(DeleteProjectHandler) {
     return HTTP_STATUS_OK;
 }
 
-HANDLER(GetProjectHandler) {
-    if (Context->Request.Method != HTTP_POST) return HTTP_STATUS_METHOD_NOT_ALLOWED;
+// NOTE(oleh): `Fields` has a `1 << PROJECT_FIELD_*` bit for each field to write.
+static void PutProject(json_writer *Writer, const project_entity *Project, u64 Fields) {
+    JsonBeginObject(Writer);
 
-    string_view ProjectId = Context->Request.Body;
+#define X(Type, Field)                                          \
+    if (Fields & ((u64)1 << PROJECT_FIELD_##Field)) {           \
+        JsonPutKey(Writer, SV_LIT(#Field));                     \
+        JsonPut_##Type(Writer, Project->Field);                 \
+    }
+
+    DECLARE_PROJECT_ENTITY
+#undef X
+
+    JsonEndObject(Writer);
+}
+
+HANDLER(GetProjectHandler) {
+    // NOTE(oleh): The Id comes either from the `/projects/:id` route or from the body of `/get-project`.
+    string_view ProjectId;
+    if (!HttpRequestGetParam(&Context->Request, "id", &ProjectId)) ProjectId = Context->Request.Body;
     if (ProjectId.Count == 0) return HTTP_STATUS_BAD_REQUEST;
 
     project_entity Project;
+    string_view ProjectJson;
+    u64 CacheGeneration;
+
+    if (ProjectCacheGet(Context->Arena, ProjectId, &Project, &ProjectJson, &CacheGeneration)) {
+        Context->Content = ProjectJson;
+        return HTTP_STATUS_OK;
+    }
+
     if (!DbGetProjectById(Context->Arena, ProjectId, &Project)) return HTTP_STATUS_NOT_FOUND;
 
-#define X(Type, Field) \
-    JsonPutKey(SV_LIT(#Field)); \
-    JsonPut_##Type(Project.Field);
+    json_writer Writer;
+    JsonWriterInitArena(&Writer, Context->Arena);
 
-    JsonBegin(Context->Arena);
+    PutProject(&Writer, &Project, PROJECT_ALL_FIELDS);
 
-    JsonBeginObject();
-    DECLARE_PROJECT_ENTITY
-#undef X
-    JsonEndObject();
+    ProjectJson = JsonWriterEnd(&Writer);
+    ProjectCachePut(CacheGeneration, &Project, ProjectJson);
 
-    string_view ProjectJson = JsonEnd();
     Context->Content = ProjectJson;
     return HTTP_STATUS_OK;
 }
 
-HANDLER(GetAllProjectsHandler) {
-    if (Context->Request.Method != HTTP_GET) return HTTP_STATUS_METHOD_NOT_ALLOWED;
+HANDLER(GetProjectByNameHandler) {
+    string_view ProjectName = Context->Request.Body;
+    if (ProjectName.Count == 0) return HTTP_STATUS_BAD_REQUEST;
+
+    project_entity Project;
+    if (!DbGetProjectByName(Context->Arena, ProjectName, &Project)) return HTTP_STATUS_NOT_FOUND;
 
-    project_entity *Projects;
-    uz ProjectsCount;
+    json_writer Writer;
+    JsonWriterInitArena(&Writer, Context->Arena);
 
-    if (!DbGetAllProjects(Context->Arena, &Projects, &ProjectsCount)) return HTTP_STATUS_INTERNAL_SERVER_ERROR;
+    PutProject(&Writer, &Project, PROJECT_ALL_FIELDS);
 
-    JsonBegin(Context->Arena);
-    JsonBeginArray();
+    Context->Content = JsonWriterEnd(&Writer);
+    return HTTP_STATUS_OK;
+}
+
+// NOTE(oleh): Lists are serialized into a buffer of this size that is sent out as a chunk
+// whenever it fills up, so the response never takes more memory than that no matter how many
+// entities there are.
+#define RESPONSE_STREAM_CHUNK_SIZE (16 * 1024)
+
+// NOTE(oleh): Lists are produced from the worker loop one batch per call, so a slow client never
+// holds up the others. Every batch is a query of its own that resumes after the last entity sent,
+// no database client is kept while the response waits on the socket. A paused stream would
+// otherwise hold on to a pooled client, and enough of them block the worker on the pool.
+#define LIST_STREAM_BATCH_SIZE 100
+
+typedef struct {
+    http_response_context *Context;
+    json_writer Writer;
+
+    // NOTE(oleh): Set when the whole project list is sent, which fills the cache on the way out.
+    project_list_fill *CacheFill;
+} list_stream;
+
+static b32 FlushListStream(void *UserData, string_view Chunk) {
+    list_stream *Stream = UserData;
+    if (Stream->CacheFill) ProjectListFillAppend(Stream->CacheFill, Chunk);
+    HttpResponseWrite(Stream->Context, Chunk);
+    return 1;
+}
 
-    for (uz ProjectIndex = 0; ProjectIndex < ProjectsCount; ++ProjectIndex) {
-        project_entity Project = Projects[ProjectIndex];
+static void FinishListStream(void *UserData) {
+    list_stream *Stream = UserData;
+    if (Stream->CacheFill) ProjectListFillEnd(Stream->CacheFill, 0);
+}
 
-        JsonPrepareArrayElement();
+static void BeginListStream(http_response_context *Context, list_stream *Stream, http_stream_producer Produce) {
+    Stream->Context = Context;
 
-        JsonBeginObject();
+    JsonWriterInitBuffer(&Stream->Writer, ArenaPush(Context->Arena, RESPONSE_STREAM_CHUNK_SIZE), RESPONSE_STREAM_CHUNK_SIZE,
+                         FlushListStream, Stream);
+    JsonBeginArray(&Stream->Writer);
 
-#define X(Type, Field)                          \
-        JsonPutKey(SV_LIT(#Field));             \
-        JsonPut_##Type(Project.Field);
+    HttpResponseStream(Context, Produce, Stream);
+    HttpResponseOnFinish(Context, FinishListStream, Stream);
+}
+
+static http_stream_result EndListStream(list_stream *Stream, b32 Ok) {
+    if (Ok) {
+        JsonEndArray(&Stream->Writer);
+        JsonWriterFlush(&Stream->Writer);
+    }
+
+    if (Stream->CacheFill) ProjectListFillEnd(Stream->CacheFill, Ok);
+    Stream->CacheFill = NULL;
+
+    return Ok ? HTTP_STREAM_DONE : HTTP_STREAM_FAILED;
+}
+
+// NOTE(oleh): Ids to resume after outlive the batch they came from, so they are copied out of it.
+static string_view ListStreamKeepId(http_response_context *Context, string_view Id) {
+    return (string_view) {.Items = (u8 *)StringViewCloneCStr(Context->Arena, Id), .Count = Id.Count};
+}
+
+typedef struct {
+    list_stream List;
+    db_projects_page Next;
+    // NOTE(oleh): Projects still to send when the page has a limit.
+    u32 Remaining;
+    project_list_fill CacheFill;
+} projects_stream;
+
+static http_stream_result ProduceProjects(http_response_context *Context, void *State) {
+    projects_stream *Stream = State;
+
+    u32 BatchLimit = LIST_STREAM_BATCH_SIZE;
+    if (Stream->Next.Limit > 0 && BatchLimit > Stream->Remaining) BatchLimit = Stream->Remaining;
+
+    db_projects_page Batch = Stream->Next;
+    Batch.Limit = BatchLimit;
 
-        DECLARE_PROJECT_ENTITY
+    db_cursor Cursor;
+    if (!DbProjectsCursorOpen(&Cursor, &Batch)) return EndListStream(&Stream->List, 0);
+
+    u32 Count = 0;
+    project_entity Project;
+    while (DbProjectsCursorNext(&Cursor, &Project)) {
+        PutProject(&Stream->List.Writer, &Project, Batch.Fields);
+        Count += 1;
+
+        if (Count == BatchLimit) Stream->Next.After = ListStreamKeepId(Context, Project.Id);
+    }
+
+    if (!DbCursorClose(&Cursor)) return EndListStream(&Stream->List, 0);
+
+    if (Stream->Next.Limit > 0) Stream->Remaining -= Count;
+    if (Count < BatchLimit || (Stream->Next.Limit > 0 && Stream->Remaining == 0)) return EndListStream(&Stream->List, 1);
+    return HTTP_STREAM_MORE;
+}
+
+#define PROJECTS_PAGE_MAX_LIMIT 1000
+
+static const string_view ProjectFieldNames[] = {
+#define X(Type, Field) [PROJECT_FIELD_##Field] = {.Items = (u8 *)#Field, .Count = sizeof(#Field) - 1},
+    DECLARE_PROJECT_ENTITY
 #undef X
+};
+
+// NOTE(oleh): `?after=<Id>&limit=N&fields=Id,Name`. Without `after` and `limit` the page is the
+// whole list, otherwise it has at most `PROJECTS_PAGE_MAX_LIMIT` projects. The Id is always sent,
+// it is what the next page starts after.
+static b32 ParseProjectsPage(http_response_context *Context, db_projects_page *Page) {
+    *Page = (db_projects_page) {.Fields = PROJECT_ALL_FIELDS};
+
+    b32 HasAfter = HttpRequestGetQueryParam(Context->Arena, &Context->Request, "after", &Page->After);
 
-        JsonEndObject();
+    string_view Limit;
+    if (HttpRequestGetQueryParam(Context->Arena, &Context->Request, "limit", &Limit)) {
+        if (Limit.Count == 0 || Limit.Count > 4) return 0;
+
+        for (uz Index = 0; Index < Limit.Count; ++Index) {
+            u8 Digit = Limit.Items[Index];
+            if (Digit < '0' || Digit > '9') return 0;
+            Page->Limit = Page->Limit * 10 + (Digit - '0');
+        }
+
+        if (Page->Limit == 0 || Page->Limit > PROJECTS_PAGE_MAX_LIMIT) return 0;
+    } else if (HasAfter) {
+        Page->Limit = PROJECTS_PAGE_MAX_LIMIT;
     }
 
-    JsonEndArray();
+    string_view Fields;
+    if (HttpRequestGetQueryParam(Context->Arena, &Context->Request, "fields", &Fields)) {
+        Page->Fields = (u64)1 << PROJECT_FIELD_Id;
 
-    string_view ProjectJson = JsonEnd();
-    Context->Content = ProjectJson;
+        while (Fields.Count > 0) {
+            uz NameEnd = ScanFindByte(Fields.Items, Fields.Count, ',');
+            string_view Name = {.Items = Fields.Items, .Count = NameEnd};
+
+            uz FieldIndex = 0;
+            while (FieldIndex < PROJECT_FIELDS_COUNT && !StringViewEqual(ProjectFieldNames[FieldIndex], Name)) ++FieldIndex;
+            if (FieldIndex == PROJECT_FIELDS_COUNT) return 0;
+
+            Page->Fields |= (u64)1 << FieldIndex;
+
+            uz Consumed = NameEnd < Fields.Count ? NameEnd + 1 : NameEnd;
+            Fields.Items += Consumed;
+            Fields.Count -= Consumed;
+        }
+    }
+
+    return 1;
+}
+
+// NOTE(oleh): Generations restart from zero with the process, so the start time keeps old ETags from matching.
+static u64 ProjectsETagEpoch;
+
+static void ReleaseCachedProjectList(void *List) {
+    ProjectListRelease(List);
+}
+
+HANDLER(GetAllProjectsHandler) {
+    u64 Generation = ProjectCacheGetGeneration();
+
+    // NOTE(oleh): Only the 200 and the 304 get the ETag, errors never carried the list it stands for.
+    string_view ETag = ArenaFormat(Context->Arena, "\"%llx-%llx\"", (unsigned long long)ProjectsETagEpoch, (unsigned long long)Generation);
+
+    if (HttpRequestMatchesETag(&Context->Request, ETag)) {
+        HttpResponseAddHeader(Context, "ETag", ETag);
+        return HTTP_STATUS_NOT_MODIFIED;
+    }
+
+    db_projects_page Page;
+    if (!ParseProjectsPage(Context, &Page)) return HTTP_STATUS_BAD_REQUEST;
+
+    // NOTE(oleh): Only the whole list with every field is cached.
+    b32 WholeList = Page.Limit == 0 && Page.Fields == PROJECT_ALL_FIELDS;
+
+    // NOTE(oleh): A hit is sent straight from the cached list, which stays alive until it is out.
+    project_list *CachedList;
+    if (WholeList && ProjectListCacheAcquire(Generation, &CachedList)) {
+        HttpResponseOnFinish(Context, ReleaseCachedProjectList, CachedList);
+        HttpResponseAddHeader(Context, "ETag", ETag);
+        Context->Content = (string_view) {.Items = CachedList->Items, .Count = CachedList->Count};
+        return HTTP_STATUS_OK;
+    }
+
+    projects_stream *Stream = ARENA_NEW(Context->Arena, projects_stream);
+    Stream->Next = Page;
+    Stream->Remaining = Page.Limit;
+    if (WholeList) {
+        Stream->List.CacheFill = &Stream->CacheFill;
+        ProjectListFillBegin(&Stream->CacheFill, Generation);
+    }
+
+    HttpResponseAddHeader(Context, "ETag", ETag);
+    BeginListStream(Context, &Stream->List, ProduceProjects);
     return HTTP_STATUS_OK;
 }
 
-HANDLER(InsertUserHandler) {
-    if (Context->Request.Method != HTTP_POST) return HTTP_STATUS_METHOD_NOT_ALLOWED;
+// NOTE(oleh): Multi-gets take a JSON array of Ids and answer with an array in the same order,
+// with a null in place of every Id that does not exist.
+#define MULTI_GET_MAX_IDS 1000
 
-    json_value JsonPayloadValue;
-    if (!JsonParse(Context->Arena, Context->Request.Body, &JsonPayloadValue)) return HTTP_STATUS_BAD_REQUEST;
-    if (JsonPayloadValue.Type != JSON_OBJECT) return HTTP_STATUS_BAD_REQUEST;
+static b32 ParseIdList(http_response_context *Context, string_view **Ids, uz *IdsCount) {
+    json_value Value;
+    if (!JsonParse(Context->Arena, Context->Request.Body, &Value)) return 0;
+    if (Value.Type != JSON_ARRAY || Value.Array.Count > MULTI_GET_MAX_IDS) return 0;
 
-    json_object JsonPayload = JsonPayloadValue.Object;
+    *Ids = ArenaPush(Context->Arena, sizeof(string_view) * (Value.Array.Count + 1));
+    *IdsCount = 0;
 
-    user_entity User;
+    json_array_iterator Iterator = JsonArrayIterate(&Value.Array);
+    json_value Element;
 
-#define X(Type, Field) DEFAULT_JSON_DESERIALIZER(&JsonPayload, &User, Type, Field)
-    DECLARE_USER_ENTITY
+    while (JsonArrayNext(&Iterator, &Element)) {
+        if (Element.Type != JSON_STRING) return 0;
+        (*Ids)[(*IdsCount)++] = Element.String;
+    }
+
+    return 1;
+}
+
+HANDLER(GetProjectsHandler) {
+    string_view *Ids;
+    uz IdsCount;
+    if (!ParseIdList(Context, &Ids, &IdsCount)) return HTTP_STATUS_BAD_REQUEST;
+
+    // NOTE(oleh): A project that is not found keeps an empty JSON.
+    string_view *ProjectJsons = ArenaPush(Context->Arena, sizeof(string_view) * (IdsCount + 1));
+
+    string_view *MissedIds = ArenaPush(Context->Arena, sizeof(string_view) * (IdsCount + 1));
+    uz *MissedIndices = ArenaPush(Context->Arena, sizeof(uz) * (IdsCount + 1));
+    uz MissedCount = 0;
+
+    // NOTE(oleh): The generation of the first miss is the oldest one, a mutation after it drops every fill.
+    u64 CacheGeneration = 0;
+
+    for (uz IdIndex = 0; IdIndex < IdsCount; ++IdIndex) {
+        project_entity Project;
+        u64 Generation;
+
+        if (ProjectCacheGet(Context->Arena, Ids[IdIndex], &Project, &ProjectJsons[IdIndex], &Generation)) continue;
+
+        if (MissedCount == 0) CacheGeneration = Generation;
+
+        ProjectJsons[IdIndex] = (string_view) {0};
+        MissedIds[MissedCount] = Ids[IdIndex];
+        MissedIndices[MissedCount] = IdIndex;
+        ++MissedCount;
+    }
+
+    if (MissedCount > 0) {
+        project_entity *Projects = ArenaPush(Context->Arena, sizeof(project_entity) * MissedCount);
+        b32 *Found = ArenaPush(Context->Arena, sizeof(b32) * MissedCount);
+
+        if (!DbGetProjectsByIds(Context->Arena, MissedIds, MissedCount, PROJECT_ALL_FIELDS, Projects, Found)) {
+            return HTTP_STATUS_INTERNAL_SERVER_ERROR;
+        }
+
+        for (uz MissedIndex = 0; MissedIndex < MissedCount; ++MissedIndex) {
+            if (!Found[MissedIndex]) continue;
+
+            json_writer Writer;
+            JsonWriterInitArena(&Writer, Context->Arena);
+            PutProject(&Writer, &Projects[MissedIndex], PROJECT_ALL_FIELDS);
+
+            string_view ProjectJson = JsonWriterEnd(&Writer);
+            ProjectCachePut(CacheGeneration, &Projects[MissedIndex], ProjectJson);
+            ProjectJsons[MissedIndices[MissedIndex]] = ProjectJson;
+        }
+    }
+
+    json_writer Writer;
+    JsonWriterInitArena(&Writer, Context->Arena);
+    JsonBeginArray(&Writer);
+
+    for (uz IdIndex = 0; IdIndex < IdsCount; ++IdIndex) {
+        if (ProjectJsons[IdIndex].Items != NULL) JsonPutRaw(&Writer, ProjectJsons[IdIndex]);
+        else JsonPutNull(&Writer);
+    }
+
+    JsonEndArray(&Writer);
+
+    Context->Content = JsonWriterEnd(&Writer);
+    return HTTP_STATUS_OK;
+}
+
+// NOTE(oleh): Passwords never leave the server through lookups.
+#define USER_PUBLIC_FIELDS (USER_ALL_FIELDS & ~((u64)1 << USER_FIELD_Password))
+
+HANDLER(GetUsersHandler) {
+    string_view *Ids;
+    uz IdsCount;
+    if (!ParseIdList(Context, &Ids, &IdsCount)) return HTTP_STATUS_BAD_REQUEST;
+
+    user_entity *Users = ArenaPush(Context->Arena, sizeof(user_entity) * (IdsCount + 1));
+    b32 *Found = ArenaPush(Context->Arena, sizeof(b32) * (IdsCount + 1));
+
+    if (!DbGetUsersByIds(Context->Arena, Ids, IdsCount, USER_PUBLIC_FIELDS, Users, Found)) return HTTP_STATUS_INTERNAL_SERVER_ERROR;
+
+    json_writer Writer;
+    JsonWriterInitArena(&Writer, Context->Arena);
+    JsonBeginArray(&Writer);
+
+    for (uz IdIndex = 0; IdIndex < IdsCount; ++IdIndex) {
+        if (!Found[IdIndex]) {
+            JsonPutNull(&Writer);
+            continue;
+        }
+
+        JsonBeginObject(&Writer);
+
+#define X(Type, Field)                                          \
+        if (USER_PUBLIC_FIELDS & ((u64)1 << USER_FIELD_##Field)) { \
+            JsonPutKey(&Writer, SV_LIT(#Field));                \
+            JsonPut_##Type(&Writer, Users[IdIndex].Field);      \
+        }
+
+        DECLARE_USER_ENTITY
 #undef X
 
-    if (!DbInsertUser(&User)) return HTTP_STATUS_INTERNAL_SERVER_ERROR;
+        JsonEndObject(&Writer);
+    }
+
+    JsonEndArray(&Writer);
+
+    Context->Content = JsonWriterEnd(&Writer);
     return HTTP_STATUS_OK;
 }
 
+HANDLER(InsertUserHandler) {
+    user_entity User;
+    if (!SchemaDecode_user_entity(Context->Arena, Context->Request.Body, &User)) return HTTP_STATUS_BAD_REQUEST;
+
+    switch (DbInsertUser(&User)) {
+    case DB_INSERT_OK: return HTTP_STATUS_OK;
+    case DB_INSERT_DUPLICATE:
+    case DB_INSERT_DUPLICATE_ID: return HTTP_STATUS_CONFLICT;
+    case DB_INSERT_FAILED: return HTTP_STATUS_INTERNAL_SERVER_ERROR;
+    }
+
+    UNREACHABLE();
+}
+
 HANDLER(LoginUserHandler) {
-    if (Context->Request.Method != HTTP_POST) return HTTP_STATUS_METHOD_NOT_ALLOWED;
+    login_request Login;
+    if (!SchemaDecode_login_request(Context->Arena, Context->Request.Body, &Login)) return HTTP_STATUS_BAD_REQUEST;
+
+    user_entity User;
+    if (!DbGetUserByLogin(Context->Arena, Login.FirstName, Login.LastName, &User)) return HTTP_STATUS_NOT_FOUND;
+
+    if (!(StringViewEqual(User.FirstName, Login.FirstName) &&
+          StringViewEqual(User.LastName, Login.LastName) &&
+          StringViewEqual(User.Password, Login.Password))) return HTTP_STATUS_BAD_REQUEST;
+
+    json_writer Writer;
+    JsonWriterInitArena(&Writer, Context->Arena);
+    JsonBeginObject(&Writer);
+
+#define X(Type, Name) \
+    JsonPutKey(&Writer, SV_LIT(#Name)); \
+    JsonPut_##Type(&Writer, User.Name);
+
+    DECLARE_USER_ENTITY
+#undef X
 
-    json_value JsonPayloadValue;
-    if (!JsonParse(Context->Arena, Context->Request.Body, &JsonPayloadValue)) return HTTP_STATUS_BAD_REQUEST;
-    if (JsonPayloadValue.Type != JSON_OBJECT) return HTTP_STATUS_BAD_REQUEST;
+    JsonEndObject(&Writer);
 
-    json_object JsonPayload = JsonPayloadValue.Object;
+    string_view UserJson = JsonWriterEnd(&Writer);
+    Context->Content = UserJson;
+    return HTTP_STATUS_OK;
+}
 
-    string_view FirstName, LastName, Password;
+#define REGISTER_USER_MAX_ATTEMPTS 4
 
-    if (!JsonObjectGet_string_view(&JsonPayload, SV_LIT("FirstName"), &FirstName)) return HTTP_STATUS_BAD_REQUEST;
-    if (!JsonObjectGet_string_view(&JsonPayload, SV_LIT("LastName"), &LastName)) return HTTP_STATUS_BAD_REQUEST;
-    if (!JsonObjectGet_string_view(&JsonPayload, SV_LIT("Password"), &Password)) return HTTP_STATUS_BAD_REQUEST;
+HANDLER(RegisterUserHandler) {
+    register_request Register;
+    if (!SchemaDecode_register_request(Context->Arena, Context->Request.Body, &Register)) return HTTP_STATUS_BAD_REQUEST;
 
+    // NOTE(oleh): The unique index on the login rejects the insert if the user already exists.
+    // A clash of the generated Id is astronomically unlikely, but it is not the client's fault,
+    // so it just gets another Id.
     user_entity User;
-    if (!DbGetUserByLogin(Context->Arena, FirstName, LastName, &User)) return HTTP_STATUS_NOT_FOUND;
+    db_insert_result InsertResult = DB_INSERT_DUPLICATE_ID;
 
-    if (!(StringViewEqual(User.FirstName, FirstName) &&
-          StringViewEqual(User.LastName, LastName) &&
-          StringViewEqual(User.Password, Password))) return HTTP_STATUS_BAD_REQUEST;
+    for (uz Attempt = 0; Attempt < REGISTER_USER_MAX_ATTEMPTS && InsertResult == DB_INSERT_DUPLICATE_ID; ++Attempt) {
+        User = CreateUserWithRandomId(Context->Arena, Register.FirstName, Register.LastName, Register.Password, Register.Role);
+        InsertResult = DbInsertUser(&User);
+    }
+
+    if (InsertResult == DB_INSERT_DUPLICATE) return HTTP_STATUS_CONFLICT;
+    if (InsertResult != DB_INSERT_OK) return HTTP_STATUS_INTERNAL_SERVER_ERROR;
 
-    JsonBegin(Context->Arena);
-    JsonBeginObject();
+    json_writer Writer;
+    JsonWriterInitArena(&Writer, Context->Arena);
+    JsonBeginObject(&Writer);
 
 #define X(Type, Name) \
-    JsonPutKey(SV_LIT(#Name)); \
-    JsonPut_##Type(User.Name);
+    JsonPutKey(&Writer, SV_LIT(#Name)); \
+    JsonPut_##Type(&Writer, User.Name);
 
     DECLARE_USER_ENTITY
 #undef X
 
-    JsonEndObject();
+    JsonEndObject(&Writer);
 
-    string_view UserJson = JsonEnd();
+    string_view UserJson = JsonWriterEnd(&Writer);
     Context->Content = UserJson;
     return HTTP_STATUS_OK;
 }
 
-HANDLER(RegisterUserHandler) {
-    if (Context->Request.Method != HTTP_POST) return HTTP_STATUS_METHOD_NOT_ALLOWED;
+HANDLER(InsertFeatureHandler) {
+    feature_entity Feature;
+    if (!SchemaDecode_feature_entity(Context->Arena, Context->Request.Body, &Feature)) return HTTP_STATUS_BAD_REQUEST;
+
+    switch (DbInsertFeature(&Feature)) {
+    case DB_INSERT_OK: return HTTP_STATUS_OK;
+    case DB_INSERT_DUPLICATE:
+    case DB_INSERT_DUPLICATE_ID: return HTTP_STATUS_CONFLICT;
+    case DB_INSERT_FAILED: return HTTP_STATUS_INTERNAL_SERVER_ERROR;
+    }
+
+    UNREACHABLE();
+}
 
-    json_value JsonPayloadValue;
-    if (!JsonParse(Context->Arena, Context->Request.Body, &JsonPayloadValue)) return HTTP_STATUS_BAD_REQUEST;
-    if (JsonPayloadValue.Type != JSON_OBJECT) return HTTP_STATUS_BAD_REQUEST;
+HANDLER(UpdateFeatureHandler) {
+    feature_entity Feature;
+    if (!SchemaDecode_feature_entity(Context->Arena, Context->Request.Body, &Feature)) return HTTP_STATUS_BAD_REQUEST;
 
-    json_object JsonPayload = JsonPayloadValue.Object;
+    switch (DbUpdateFeature(&Feature)) {
+    case DB_WRITE_OK: return HTTP_STATUS_OK;
+    case DB_WRITE_NOT_FOUND: return HTTP_STATUS_NOT_FOUND;
+    case DB_WRITE_FAILED: return HTTP_STATUS_INTERNAL_SERVER_ERROR;
+    }
 
-    string_view FirstName, LastName, Password, Role;
+    UNREACHABLE();
+}
 
-    if (!JsonObjectGet_string_view(&JsonPayload, SV_LIT("FirstName"), &FirstName)) return HTTP_STATUS_BAD_REQUEST;
-    if (!JsonObjectGet_string_view(&JsonPayload, SV_LIT("LastName"), &LastName)) return HTTP_STATUS_BAD_REQUEST;
-    if (!JsonObjectGet_string_view(&JsonPayload, SV_LIT("Password"), &Password)) return HTTP_STATUS_BAD_REQUEST;
-    if (!JsonObjectGet_string_view(&JsonPayload, SV_LIT("Role"), &Role)) return HTTP_STATUS_BAD_REQUEST;
+HANDLER(DeleteFeatureHandler) {
+    string_view FeatureId = Context->Request.Body;
+    if (FeatureId.Count == 0) return HTTP_STATUS_BAD_REQUEST;
 
-    user_entity DuplicateUser;
-    if (DbGetUserByLogin(Context->Arena, FirstName, LastName, &DuplicateUser)) return HTTP_STATUS_BAD_REQUEST;
+    switch (DbDeleteFeatureById(FeatureId)) {
+    case DB_WRITE_OK: return HTTP_STATUS_OK;
+    case DB_WRITE_NOT_FOUND: return HTTP_STATUS_NOT_FOUND;
+    case DB_WRITE_FAILED: return HTTP_STATUS_INTERNAL_SERVER_ERROR;
+    }
 
-    user_entity User = CreateUserWithRandomId(Context->Arena, FirstName, LastName, Password, Role);
-    if (!DbInsertUser(&User)) return HTTP_STATUS_NOT_FOUND;
+    UNREACHABLE();
+}
 
-    JsonBegin(Context->Arena);
-    JsonBeginObject();
+static void PutFeature(json_writer *Writer, const feature_entity *Feature) {
+    JsonBeginObject(Writer);
 
-#define X(Type, Name) \
-    JsonPutKey(SV_LIT(#Name)); \
-    JsonPut_##Type(User.Name);
+#define X(Type, Field)                          \
+    JsonPutKey(Writer, SV_LIT(#Field));         \
+    JsonPut_##Type(Writer, Feature->Field);
 
-DECLARE_USER_ENTITY
+    DECLARE_FEATURE_ENTITY
 #undef X
 
-JsonEndObject();
+    JsonEndObject(Writer);
+}
 
-    string_view UserJson = JsonEnd();
-    Context->Content = UserJson;
+HANDLER(GetFeatureHandler) {
+    // NOTE(oleh): The Id comes either from the `/features/:id` route or from the body of `/get-feature`.
+    string_view FeatureId;
+    if (!HttpRequestGetParam(&Context->Request, "id", &FeatureId)) FeatureId = Context->Request.Body;
+    if (FeatureId.Count == 0) return HTTP_STATUS_BAD_REQUEST;
+
+    feature_entity Feature;
+    if (!DbGetFeatureById(Context->Arena, FeatureId, &Feature)) return HTTP_STATUS_NOT_FOUND;
+
+    json_writer Writer;
+    JsonWriterInitArena(&Writer, Context->Arena);
+    PutFeature(&Writer, &Feature);
+
+    Context->Content = JsonWriterEnd(&Writer);
+    return HTTP_STATUS_OK;
+}
+
+typedef struct {
+    list_stream List;
+    string_view ProjectId;
+    b32 HasAfter;
+    feature_entity After;
+} features_stream;
+
+static http_stream_result ProduceFeatures(http_response_context *Context, void *State) {
+    features_stream *Stream = State;
+
+    db_cursor Cursor;
+    if (!DbProjectFeaturesCursorOpen(&Cursor, Stream->ProjectId, Stream->HasAfter ? &Stream->After : NULL, LIST_STREAM_BATCH_SIZE)) {
+        return EndListStream(&Stream->List, 0);
+    }
+
+    u32 Count = 0;
+    feature_entity Feature;
+    while (DbFeaturesCursorNext(&Cursor, &Feature)) {
+        PutFeature(&Stream->List.Writer, &Feature);
+        Count += 1;
+
+        if (Count == LIST_STREAM_BATCH_SIZE) {
+            Stream->HasAfter = 1;
+            Stream->After.Id = ListStreamKeepId(Context, Feature.Id);
+            Stream->After.State = Feature.State;
+            Stream->After.Priority = Feature.Priority;
+        }
+    }
+
+    if (!DbCursorClose(&Cursor)) return EndListStream(&Stream->List, 0);
+    return Count < LIST_STREAM_BATCH_SIZE ? EndListStream(&Stream->List, 1) : HTTP_STREAM_MORE;
+}
+
+HANDLER(GetProjectFeaturesHandler) {
+    // NOTE(oleh): The project Id comes either from the `/projects/:id/features` route or from the body of `/get-project-features`.
+    string_view ProjectId;
+    if (!HttpRequestGetParam(&Context->Request, "id", &ProjectId)) ProjectId = Context->Request.Body;
+    if (ProjectId.Count == 0) return HTTP_STATUS_BAD_REQUEST;
+
+    features_stream *Stream = ARENA_NEW(Context->Arena, features_stream);
+    // NOTE(oleh): Every batch looks the project up again, long after the request itself is gone.
+    Stream->ProjectId = ListStreamKeepId(Context, ProjectId);
+
+    BeginListStream(Context, &Stream->List, ProduceFeatures);
+    return HTTP_STATUS_OK;
+}
+
+HANDLER(MetricsHandler) {
+    Context->Content = MetricsFormat(Context->Arena);
+    HttpResponseAddHeader(Context, "Content-Type", SV_LIT("text/plain; version=0.0.4"));
     return HTTP_STATUS_OK;
 }
 
 int main() {
-    srand(time(NULL));
+    ProjectsETagEpoch = (u64)time(NULL);
 
-    arena *TempArena = GetTempArena();
+    scratch_arena Scratch = ScratchBegin(NULL, 0);
 
     string_view EnvFileContents;
-    ASSERT(ReadFullFile(TempArena, ".env", &EnvFileContents));
+    ASSERT(ReadFullFile(Scratch.Arena, ".env", &EnvFileContents));
 
     uz VarStart = 0;
 
@@ -246,8 +667,8 @@ int main() {
             string_view VarNameSv = {.Items = EnvFileContents.Items + VarStart, .Count = VarEnd - VarStart};
             string_view VarValueSv = {.Items = EnvFileContents.Items + VarEnd + 1, .Count = Index - VarEnd - 1};
 
-            const char *VarName = StringViewCloneCStr(TempArena, VarNameSv);
-            const char *VarValue = StringViewCloneCStr(TempArena, VarValueSv);
+            const char *VarName = StringViewCloneCStr(Scratch.Arena, VarNameSv);
+            const char *VarValue = StringViewCloneCStr(Scratch.Arena, VarValueSv);
 
             int Res = setenv(VarName, VarValue, 1);
             if (Res == -1) {
@@ -259,25 +680,50 @@ int main() {
         }
     }
 
+    ScratchEnd(Scratch);
+
     DbInit();
 
     http_server Server;
     HttpServerInit(&Server);
 
-    u16 ServerPort = 5959;
-
-    HttpServerAttachHandler(&Server, "/", IndexHandler);
+    const char *WorkersCountString = getenv(HTTP_WORKERS_COUNT_VAR);
+    if (WorkersCountString != NULL) {
+        long WorkersCount = strtol(WorkersCountString, NULL, 10);
+        if (WorkersCount <= 0) {
+            PANIC_FMT("Expected a positive number of workers (var '%s'), got '%s'", HTTP_WORKERS_COUNT_VAR, WorkersCountString);
+        }
 
-    HttpServerAttachHandler(&Server, "/insert-project", InsertProjectHandler);
-    HttpServerAttachHandler(&Server, "/update-project", UpdateProjectHandler);
-    HttpServerAttachHandler(&Server, "/delete-project", DeleteProjectHandler);
-    HttpServerAttachHandler(&Server, "/get-project", GetProjectHandler);
-    HttpServerAttachHandler(&Server, "/get-all-projects", GetAllProjectsHandler);
+        Server.WorkersCount = WorkersCount;
+    }
 
-    HttpServerAttachHandler(&Server, "/insert-user", InsertUserHandler);
-    HttpServerAttachHandler(&Server, "/login-user", LoginUserHandler);
-    HttpServerAttachHandler(&Server, "/register-user", RegisterUserHandler);
+    u16 ServerPort = 5959;
 
-    printf("Starting the server on port %u\n", ServerPort);
+    HttpServerAttachHandler(&Server, HTTP_GET, "/", IndexHandler);
+    HttpServerAttachHandler(&Server, HTTP_GET, "/metrics", MetricsHandler);
+
+    HttpServerAttachHandler(&Server, HTTP_POST, "/insert-project", InsertProjectHandler);
+    HttpServerAttachHandler(&Server, HTTP_POST, "/update-project", UpdateProjectHandler);
+    HttpServerAttachHandler(&Server, HTTP_POST, "/delete-project", DeleteProjectHandler);
+    HttpServerAttachHandler(&Server, HTTP_POST, "/get-project", GetProjectHandler);
+    HttpServerAttachHandler(&Server, HTTP_POST, "/get-project-by-name", GetProjectByNameHandler);
+    HttpServerAttachHandler(&Server, HTTP_POST, "/get-projects", GetProjectsHandler);
+    HttpServerAttachHandler(&Server, HTTP_GET, "/get-all-projects", GetAllProjectsHandler);
+    HttpServerAttachHandler(&Server, HTTP_GET, "/projects/:id", GetProjectHandler);
+
+    HttpServerAttachHandler(&Server, HTTP_POST, "/insert-user", InsertUserHandler);
+    HttpServerAttachHandler(&Server, HTTP_POST, "/login-user", LoginUserHandler);
+    HttpServerAttachHandler(&Server, HTTP_POST, "/register-user", RegisterUserHandler);
+    HttpServerAttachHandler(&Server, HTTP_POST, "/get-users", GetUsersHandler);
+
+    HttpServerAttachHandler(&Server, HTTP_POST, "/insert-feature", InsertFeatureHandler);
+    HttpServerAttachHandler(&Server, HTTP_POST, "/update-feature", UpdateFeatureHandler);
+    HttpServerAttachHandler(&Server, HTTP_POST, "/delete-feature", DeleteFeatureHandler);
+    HttpServerAttachHandler(&Server, HTTP_POST, "/get-feature", GetFeatureHandler);
+    HttpServerAttachHandler(&Server, HTTP_GET, "/features/:id", GetFeatureHandler);
+    HttpServerAttachHandler(&Server, HTTP_POST, "/get-project-features", GetProjectFeaturesHandler);
+    HttpServerAttachHandler(&Server, HTTP_GET, "/projects/:id/features", GetProjectFeaturesHandler);
+
+    printf("Starting the server on port %u with %zu workers\n", ServerPort, Server.WorkersCount);
     HttpServerStart(&Server, ServerPort);
 }
@@ -0,0 +1,364 @@
+#include "metrics.h"
+#include "cache.h"
+
+// NOTE(oleh): Latencies go into log-bucketed histograms in the spirit of HdrHistogram. Values
+// below `METRICS_HISTOGRAM_SUB_BUCKETS` nanoseconds get a bucket each, every power of two
+// above that is split into `METRICS_HISTOGRAM_SUB_BUCKETS` equal buckets, so a bucket is never
+// wider than an eighth of the values it holds and the whole u64 range fits in 496 of them.
+#define METRICS_HISTOGRAM_SUB_BUCKET_BITS 3
+#define METRICS_HISTOGRAM_SUB_BUCKETS (1 << METRICS_HISTOGRAM_SUB_BUCKET_BITS)
+#define METRICS_HISTOGRAM_BUCKETS_COUNT ((64 - METRICS_HISTOGRAM_SUB_BUCKET_BITS + 1) * METRICS_HISTOGRAM_SUB_BUCKETS)
+
+// NOTE(oleh): Prometheus buckets are exported at the powers of two from about a microsecond
+// to about half a minute, finer buckets only feed the quantiles.
+#define METRICS_EXPORTED_MIN_POWER 10
+#define METRICS_EXPORTED_MAX_POWER 35
+
+typedef struct {
+    u64 Count;
+    u64 SumNs;
+    u64 Buckets[METRICS_HISTOGRAM_BUCKETS_COUNT];
+} metrics_histogram;
+
+typedef enum {
+#define X(Status, Code, Phrase) METRICS_STATUS_##Status,
+    ENUM_HTTP_RESPONSE_STATUSES
+#undef X
+    METRICS_STATUSES_COUNT,
+} metrics_status;
+
+static const u32 MetricsStatusCodes[METRICS_STATUSES_COUNT] = {
+#define X(Status, Code, Phrase) [METRICS_STATUS_##Status] = Code,
+    ENUM_HTTP_RESPONSE_STATUSES
+#undef X
+};
+
+typedef struct {
+    u64 Statuses[METRICS_STATUSES_COUNT];
+    u64 BytesIn;
+    u64 BytesOut;
+    metrics_histogram Latency;
+} metrics_route;
+
+typedef struct metrics_shard {
+    metrics_route Routes[METRICS_MAX_ROUTES];
+    metrics_histogram DbCalls[DB_CALLS_COUNT];
+    u64 ArenaHighWater[METRICS_ARENAS_COUNT];
+
+    struct metrics_shard *Next;
+} metrics_shard;
+
+// NOTE(oleh): Shards are pushed once per thread and never freed, the threads live as long as the process.
+static metrics_shard *MetricsShards;
+static _Thread_local metrics_shard *MetricsLocalShard;
+
+typedef struct {
+    const char *Method;
+    const char *Path;
+} metrics_route_label;
+
+// NOTE(oleh): Only written before the workers start, starting a thread publishes it to that thread.
+static metrics_route_label MetricsRouteLabels[METRICS_MAX_ROUTES] = {
+    [METRICS_ROUTE_UNPARSED] = {.Method = "<unparsed>", .Path = "<unparsed>"},
+#define X(Name) [METRICS_ROUTE_UNMATCHED(HTTP_##Name)] = {.Method = #Name, .Path = "<unmatched>"},
+    ENUM_HTTP_METHODS
+#undef X
+};
+static u32 MetricsRoutesCount = METRICS_RESERVED_ROUTES;
+
+static const char *MetricsMethodNames[] = {
+#define X(Method) [HTTP_##Method] = #Method,
+    ENUM_HTTP_METHODS
+#undef X
+};
+
+static const char *MetricsDbCallNames[] = {
+#define X(Name) [DB_CALL_##Name] = #Name,
+    ENUM_DB_CALLS
+#undef X
+};
+
+static const char *MetricsArenaNames[] = {
+#define X(Arena, Name) [METRICS_ARENA_##Arena] = Name,
+    ENUM_METRICS_ARENAS
+#undef X
+};
+
+u32 MetricsRegisterRoute(http_method Method, const char *Path) {
+    if (MetricsRoutesCount == METRICS_MAX_ROUTES) PANIC("Too many routes to keep metrics for");
+
+    u32 Route = MetricsRoutesCount++;
+    MetricsRouteLabels[Route] = (metrics_route_label) {.Method = MetricsMethodNames[Method], .Path = Path};
+    return Route;
+}
+
+static metrics_shard *MetricsGetShard(void) {
+    if (MetricsLocalShard != NULL) return MetricsLocalShard;
+
+    // NOTE(oleh): Most of a shard is never touched, calloc leaves those pages uncommitted.
+    metrics_shard *Shard = calloc(1, sizeof(metrics_shard));
+    if (Shard == NULL) PANIC("Could not allocate a metrics shard");
+
+    Shard->Next = __atomic_load_n(&MetricsShards, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&MetricsShards, &Shard->Next, Shard, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    MetricsLocalShard = Shard;
+    return Shard;
+}
+
+// NOTE(oleh): Only the owning thread writes to a shard, so there is no need for a locked
+// read-modify-write. Readers see every counter whole, just not in step with the others.
+static inline void MetricsAdd(u64 *Counter, u64 Value) {
+    __atomic_store_n(Counter, __atomic_load_n(Counter, __ATOMIC_RELAXED) + Value, __ATOMIC_RELAXED);
+}
+
+static inline u64 MetricsLoad(const u64 *Counter) {
+    return __atomic_load_n(Counter, __ATOMIC_RELAXED);
+}
+
+static inline uz MetricsHistogramBucket(u64 Value) {
+    if (Value < METRICS_HISTOGRAM_SUB_BUCKETS) return Value;
+
+    u32 Shift = (63 - __builtin_clzll(Value)) - METRICS_HISTOGRAM_SUB_BUCKET_BITS;
+    return (uz)(Shift + 1) * METRICS_HISTOGRAM_SUB_BUCKETS + ((Value >> Shift) - METRICS_HISTOGRAM_SUB_BUCKETS);
+}
+
+static inline u64 MetricsHistogramBucketStart(uz Bucket) {
+    if (Bucket < METRICS_HISTOGRAM_SUB_BUCKETS) return Bucket;
+
+    u32 Shift = Bucket / METRICS_HISTOGRAM_SUB_BUCKETS - 1;
+    return (u64)(METRICS_HISTOGRAM_SUB_BUCKETS + Bucket % METRICS_HISTOGRAM_SUB_BUCKETS) << Shift;
+}
+
+static inline u64 MetricsHistogramBucketWidth(uz Bucket) {
+    if (Bucket < METRICS_HISTOGRAM_SUB_BUCKETS) return 1;
+    return (u64)1 << (Bucket / METRICS_HISTOGRAM_SUB_BUCKETS - 1);
+}
+
+static void MetricsHistogramRecord(metrics_histogram *Histogram, u64 ValueNs) {
+    MetricsAdd(&Histogram->Count, 1);
+    MetricsAdd(&Histogram->SumNs, ValueNs);
+    MetricsAdd(&Histogram->Buckets[MetricsHistogramBucket(ValueNs)], 1);
+}
+
+static metrics_status MetricsStatusSlot(http_response_status Status) {
+    switch (Status) {
+#define X(Status, Code, Phrase) case HTTP_STATUS_##Status: return METRICS_STATUS_##Status;
+    ENUM_HTTP_RESPONSE_STATUSES
+#undef X
+    default: UNREACHABLE();
+    }
+}
+
+void MetricsRecordRequest(u32 Route, http_response_status Status, u64 BytesIn, u64 BytesOut, u64 ElapsedNs) {
+    ASSERT(Route < MetricsRoutesCount);
+
+    metrics_route *Metrics = &MetricsGetShard()->Routes[Route];
+    MetricsAdd(&Metrics->Statuses[MetricsStatusSlot(Status)], 1);
+    MetricsAdd(&Metrics->BytesIn, BytesIn);
+    MetricsAdd(&Metrics->BytesOut, BytesOut);
+    MetricsHistogramRecord(&Metrics->Latency, ElapsedNs);
+}
+
+void MetricsRecordDbCall(db_call Call, u64 ElapsedNs) {
+    MetricsHistogramRecord(&MetricsGetShard()->DbCalls[Call], ElapsedNs);
+}
+
+void MetricsRecordArenaHighWater(metrics_arena Arena, uz Bytes) {
+    u64 *HighWater = &MetricsGetShard()->ArenaHighWater[Arena];
+    if (Bytes > MetricsLoad(HighWater)) __atomic_store_n(HighWater, Bytes, __ATOMIC_RELAXED);
+}
+
+static void MetricsHistogramMerge(metrics_histogram *Total, const metrics_histogram *Histogram) {
+    Total->Count += MetricsLoad(&Histogram->Count);
+    Total->SumNs += MetricsLoad(&Histogram->SumNs);
+    for (uz Bucket = 0; Bucket < METRICS_HISTOGRAM_BUCKETS_COUNT; ++Bucket) {
+        Total->Buckets[Bucket] += MetricsLoad(&Histogram->Buckets[Bucket]);
+    }
+}
+
+// NOTE(oleh): Nothing else allocates from `Arena` while the text is written, so every piece
+// lands right after the previous one.
+static void MetricsAppend(arena *Arena, const char *Fmt, ...) {
+    va_list Args;
+    va_start(Args, Fmt);
+    int BytesNeeded = vsnprintf(NULL, 0, Fmt, Args);
+    va_end(Args);
+
+    u8 *Buffer = ArenaEnsure(Arena, BytesNeeded + 1);
+    va_start(Args, Fmt);
+    vsnprintf((char *)Buffer, BytesNeeded + 1, Fmt, Args);
+    va_end(Args);
+
+    Arena->Offset += BytesNeeded;
+    ArenaTrackHighWater(Arena);
+}
+
+// NOTE(oleh): Bucket boundaries fall on powers of two, so `le` counts the values below the bound rather than up to it.
+static void MetricsAppendHistogram(arena *Arena, const char *Name, const char *Labels, const metrics_histogram *Histogram) {
+    const char *Separator = Labels[0] != '\0' ? "," : "";
+
+    u64 Cumulative = 0;
+    uz Bucket = 0;
+
+    for (u32 Power = METRICS_EXPORTED_MIN_POWER; Power <= METRICS_EXPORTED_MAX_POWER; ++Power) {
+        uz BucketsEnd = MetricsHistogramBucket((u64)1 << Power);
+        for (; Bucket < BucketsEnd; ++Bucket) Cumulative += Histogram->Buckets[Bucket];
+
+        MetricsAppend(Arena, "%s_bucket{%s%sle=\"%.10g\"} %lu\n", Name, Labels, Separator, (double)((u64)1 << Power) / 1e9, Cumulative);
+    }
+
+    MetricsAppend(Arena, "%s_bucket{%s%sle=\"+Inf\"} %lu\n", Name, Labels, Separator, Histogram->Count);
+    MetricsAppend(Arena, "%s_sum{%s} %.9f\n", Name, Labels, (double)Histogram->SumNs / 1e9);
+    MetricsAppend(Arena, "%s_count{%s} %lu\n", Name, Labels, Histogram->Count);
+}
+
+static const double MetricsQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+// NOTE(oleh): A quantile is reported as the middle of the bucket it falls into.
+static void MetricsAppendQuantiles(arena *Arena, const char *Name, const char *Labels, const metrics_histogram *Histogram) {
+    const char *Separator = Labels[0] != '\0' ? "," : "";
+
+    u64 Cumulative = 0;
+    uz Bucket = 0;
+
+    for (uz QuantileIndex = 0; QuantileIndex < ARRAY_COUNT(MetricsQuantiles); ++QuantileIndex) {
+        double Quantile = MetricsQuantiles[QuantileIndex];
+
+        u64 Rank = (u64)(Quantile * (double)Histogram->Count);
+        if (Rank == 0) Rank = 1;
+
+        while (Bucket < METRICS_HISTOGRAM_BUCKETS_COUNT - 1 && Cumulative + Histogram->Buckets[Bucket] < Rank) {
+            Cumulative += Histogram->Buckets[Bucket];
+            ++Bucket;
+        }
+
+        u64 ValueNs = MetricsHistogramBucketStart(Bucket) + MetricsHistogramBucketWidth(Bucket) / 2;
+        MetricsAppend(Arena, "%s{%s%squantile=\"%g\"} %.9f\n", Name, Labels, Separator, Quantile, (double)ValueNs / 1e9);
+    }
+}
+
+string_view MetricsFormat(arena *Arena) {
+    scratch_arena Scratch = ScratchBegin(&Arena, 1);
+
+    metrics_shard *Total = ARENA_NEW(Scratch.Arena, metrics_shard);
+
+    for (metrics_shard *Shard = __atomic_load_n(&MetricsShards, __ATOMIC_ACQUIRE); Shard != NULL; Shard = Shard->Next) {
+        for (u32 Route = 0; Route < MetricsRoutesCount; ++Route) {
+            metrics_route *RouteTotal = &Total->Routes[Route];
+            const metrics_route *RouteShard = &Shard->Routes[Route];
+
+            for (uz Status = 0; Status < METRICS_STATUSES_COUNT; ++Status) {
+                RouteTotal->Statuses[Status] += MetricsLoad(&RouteShard->Statuses[Status]);
+            }
+            RouteTotal->BytesIn += MetricsLoad(&RouteShard->BytesIn);
+            RouteTotal->BytesOut += MetricsLoad(&RouteShard->BytesOut);
+            MetricsHistogramMerge(&RouteTotal->Latency, &RouteShard->Latency);
+        }
+
+        for (uz Call = 0; Call < DB_CALLS_COUNT; ++Call) MetricsHistogramMerge(&Total->DbCalls[Call], &Shard->DbCalls[Call]);
+
+        for (uz ArenaKind = 0; ArenaKind < METRICS_ARENAS_COUNT; ++ArenaKind) {
+            u64 HighWater = MetricsLoad(&Shard->ArenaHighWater[ArenaKind]);
+            if (HighWater > Total->ArenaHighWater[ArenaKind]) Total->ArenaHighWater[ArenaKind] = HighWater;
+        }
+    }
+
+    uz Start = Arena->Offset;
+
+    char Labels[256];
+
+    // 1. Requests, by the route that answered them.
+
+    MetricsAppend(Arena, "# TYPE http_requests_total counter\n");
+    for (u32 Route = 0; Route < MetricsRoutesCount; ++Route) {
+        metrics_route_label Label = MetricsRouteLabels[Route];
+        for (uz Status = 0; Status < METRICS_STATUSES_COUNT; ++Status) {
+            u64 Count = Total->Routes[Route].Statuses[Status];
+            if (Count == 0) continue;
+
+            MetricsAppend(Arena, "http_requests_total{method=\"%s\",route=\"%s\",code=\"%u\"} %lu\n",
+                          Label.Method, Label.Path, MetricsStatusCodes[Status], Count);
+        }
+    }
+
+    MetricsAppend(Arena, "# TYPE http_request_bytes_total counter\n");
+    for (u32 Route = 0; Route < MetricsRoutesCount; ++Route) {
+        if (Total->Routes[Route].Latency.Count == 0) continue;
+        metrics_route_label Label = MetricsRouteLabels[Route];
+        MetricsAppend(Arena, "http_request_bytes_total{method=\"%s\",route=\"%s\"} %lu\n", Label.Method, Label.Path, Total->Routes[Route].BytesIn);
+    }
+
+    MetricsAppend(Arena, "# TYPE http_response_bytes_total counter\n");
+    for (u32 Route = 0; Route < MetricsRoutesCount; ++Route) {
+        if (Total->Routes[Route].Latency.Count == 0) continue;
+        metrics_route_label Label = MetricsRouteLabels[Route];
+        MetricsAppend(Arena, "http_response_bytes_total{method=\"%s\",route=\"%s\"} %lu\n", Label.Method, Label.Path, Total->Routes[Route].BytesOut);
+    }
+
+    MetricsAppend(Arena, "# TYPE http_request_duration_seconds histogram\n");
+    for (u32 Route = 0; Route < MetricsRoutesCount; ++Route) {
+        if (Total->Routes[Route].Latency.Count == 0) continue;
+        metrics_route_label Label = MetricsRouteLabels[Route];
+        snprintf(Labels, sizeof(Labels), "method=\"%s\",route=\"%s\"", Label.Method, Label.Path);
+        MetricsAppendHistogram(Arena, "http_request_duration_seconds", Labels, &Total->Routes[Route].Latency);
+    }
+
+    MetricsAppend(Arena, "# TYPE http_request_duration_quantile_seconds gauge\n");
+    for (u32 Route = 0; Route < MetricsRoutesCount; ++Route) {
+        if (Total->Routes[Route].Latency.Count == 0) continue;
+        metrics_route_label Label = MetricsRouteLabels[Route];
+        snprintf(Labels, sizeof(Labels), "method=\"%s\",route=\"%s\"", Label.Method, Label.Path);
+        MetricsAppendQuantiles(Arena, "http_request_duration_quantile_seconds", Labels, &Total->Routes[Route].Latency);
+    }
+
+    // 2. Database calls.
+
+    MetricsAppend(Arena, "# TYPE db_call_duration_seconds histogram\n");
+    for (uz Call = 0; Call < DB_CALLS_COUNT; ++Call) {
+        if (Total->DbCalls[Call].Count == 0) continue;
+        snprintf(Labels, sizeof(Labels), "call=\"%s\"", MetricsDbCallNames[Call]);
+        MetricsAppendHistogram(Arena, "db_call_duration_seconds", Labels, &Total->DbCalls[Call]);
+    }
+
+    MetricsAppend(Arena, "# TYPE db_call_duration_quantile_seconds gauge\n");
+    for (uz Call = 0; Call < DB_CALLS_COUNT; ++Call) {
+        if (Total->DbCalls[Call].Count == 0) continue;
+        snprintf(Labels, sizeof(Labels), "call=\"%s\"", MetricsDbCallNames[Call]);
+        MetricsAppendQuantiles(Arena, "db_call_duration_quantile_seconds", Labels, &Total->DbCalls[Call]);
+    }
+
+    db_pool_stats Pool = DbGetPoolStats();
+    MetricsAppend(Arena, "# TYPE db_pool_acquisitions_total counter\ndb_pool_acquisitions_total %lu\n", Pool.Acquisitions);
+    MetricsAppend(Arena, "# TYPE db_pool_exhaustions_total counter\ndb_pool_exhaustions_total %lu\n", Pool.Exhaustions);
+    MetricsAppend(Arena, "# TYPE db_pool_wait_seconds_total counter\ndb_pool_wait_seconds_total %.9f\n", (double)Pool.WaitNs / 1e9);
+    MetricsAppend(Arena, "# TYPE db_pool_max_wait_seconds gauge\ndb_pool_max_wait_seconds %.9f\n", (double)Pool.MaxWaitNs / 1e9);
+    MetricsAppend(Arena, "# TYPE db_pool_in_use gauge\ndb_pool_in_use %u\n", Pool.InUse);
+    MetricsAppend(Arena, "# TYPE db_pool_max_size gauge\ndb_pool_max_size %u\n", Pool.MaxSize);
+
+    // 3. Project cache.
+
+    project_cache_stats Cache = ProjectCacheGetStats();
+    MetricsAppend(Arena, "# TYPE project_cache_hits_total counter\nproject_cache_hits_total %lu\n", Cache.Hits);
+    MetricsAppend(Arena, "# TYPE project_cache_misses_total counter\nproject_cache_misses_total %lu\n", Cache.Misses);
+    MetricsAppend(Arena, "# TYPE project_cache_evictions_total counter\nproject_cache_evictions_total %lu\n", Cache.Evictions);
+    MetricsAppend(Arena, "# TYPE project_cache_entries gauge\nproject_cache_entries %zu\n", Cache.Count);
+    MetricsAppend(Arena, "# TYPE project_list_cache_hits_total counter\nproject_list_cache_hits_total %lu\n", Cache.ListHits);
+    MetricsAppend(Arena, "# TYPE project_list_cache_misses_total counter\nproject_list_cache_misses_total %lu\n", Cache.ListMisses);
+
+    // 4. Memory.
+
+    MetricsAppend(Arena, "# TYPE arena_high_water_bytes gauge\n");
+    for (uz ArenaKind = 0; ArenaKind < METRICS_ARENAS_COUNT; ++ArenaKind) {
+        MetricsAppend(Arena, "arena_high_water_bytes{arena=\"%s\"} %lu\n", MetricsArenaNames[ArenaKind], Total->ArenaHighWater[ArenaKind]);
+    }
+
+    MetricsAppend(Arena, "# TYPE arena_committed_bytes gauge\narena_committed_bytes %zu\n", ArenaGetTotalCommitted());
+
+    string_view Result = {.Items = Arena->Items + Start, .Count = Arena->Offset - Start};
+    Arena->Offset = AlignForward(Arena->Offset, sizeof(uz));
+    ArenaTrackHighWater(Arena);
+
+    ScratchEnd(Scratch);
+    return Result;
+}
@@ -0,0 +1,46 @@
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include "common.h"
+#include "http.h"
+#include "db.h"
+
+// NOTE(oleh): Every thread records into a shard of its own, with plain relaxed stores, so the
+// hot path never takes a lock or writes to a cache line another thread reads from. The shards
+// are only added up when the metrics are asked for.
+
+// NOTE(oleh): The first routes are reserved. Requests that could not even be parsed are counted
+// under `METRICS_ROUTE_UNPARSED`, the ones whose path matched no attached handler under the
+// `METRICS_ROUTE_UNMATCHED` route of their method.
+#define METRICS_ROUTE_UNPARSED 0
+#define METRICS_ROUTE_UNMATCHED(Method) (1 + (u32)(Method))
+#define METRICS_RESERVED_ROUTES (1 + HTTP_METHODS_COUNT)
+#define METRICS_MAX_ROUTES 256
+
+// NOTE(oleh): Has to be called before the workers start. Paths are registered for every method,
+// the methods without a handler count the 405s of the path.
+u32 MetricsRegisterRoute(http_method Method, const char *Path);
+
+void MetricsRecordRequest(u32 Route, http_response_status Status, u64 BytesIn, u64 BytesOut, u64 ElapsedNs);
+void MetricsRecordDbCall(db_call Call, u64 ElapsedNs);
+
+#define ENUM_METRICS_ARENAS                     \
+    X(CONNECTION, "connection")                 \
+    X(READ, "read")                             \
+    X(SCRATCH, "scratch")
+
+typedef enum {
+#define X(Arena, Name) METRICS_ARENA_##Arena,
+    ENUM_METRICS_ARENAS
+#undef X
+    METRICS_ARENAS_COUNT,
+} metrics_arena;
+
+// NOTE(oleh): Keeps the largest `Bytes` ever recorded for the kind of arena.
+void MetricsRecordArenaHighWater(metrics_arena Arena, uz Bytes);
+
+// NOTE(oleh): Everything recorded so far in the Prometheus text format, together with the
+// database pool and project cache stats. (https://prometheus.io/docs/instrumenting/exposition_formats/)
+string_view MetricsFormat(arena *Arena);
+
+#endif // METRICS_H_
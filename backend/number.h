@@ -0,0 +1,27 @@
+#ifndef NUMBER_H_
+#define NUMBER_H_
+
+#include "common.h"
+
+// NOTE(oleh): Conversions between JSON numbers (RFC 8259, section 6) and doubles.
+//
+// Parsing is exact. Up to 19 significant digits are accumulated eight at a time, then the
+// value is either computed directly when the mantissa and the power of ten are both exact
+// doubles (Clinger), or from a 128-bit approximation of the power of ten (Eisel-Lemire).
+// The few inputs neither of those can decide go through `strtod`.
+//
+// Formatting produces the shortest digits that read back as the same double in practically
+// every case (Grisu2), never digits that read back as a different one.
+
+// NOTE(oleh): Rejects anything outside the JSON grammar and values that overflow a double.
+b32 NumberParseF64(string_view Input, f64 *Out);
+
+#define NUMBER_F64_MAX_CHARS 32
+#define NUMBER_U64_MAX_CHARS 20
+
+// NOTE(oleh): `Buffer` has to hold the respective `*_MAX_CHARS` bytes. Returns the count written.
+// Infinities and NaNs have no JSON representation, those come out as `null`.
+uz NumberFormatF64(f64 Value, u8 *Buffer);
+uz NumberFormatU64(u64 Value, u8 *Buffer);
+
+#endif // NUMBER_H_
@@ -0,0 +1,337 @@
+#include "scan.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define SCAN_X86_KERNELS 1
+#include <immintrin.h>
+#else
+#define SCAN_X86_KERNELS 0
+#endif
+
+static inline b32 ScanIsJsonWhitespace(u8 Char) {
+    return Char == 0x20 || Char == 0x0A || Char == 0x0D || Char == 0x09;
+}
+
+static inline b32 ScanIsJsonStringSpecial(u8 Char) {
+    return Char == '"' || Char == '\\' || Char < 0x20;
+}
+
+// 1. Scalar kernels, also used for the tails the vector kernels leave behind.
+
+static uz ScanFindByte_Scalar(const u8 *Items, uz Count, u8 Byte) {
+    for (uz I = 0; I < Count; ++I) {
+        if (Items[I] == Byte) return I;
+    }
+
+    return Count;
+}
+
+static uz ScanFindByte2_Scalar(const u8 *Items, uz Count, u8 First, u8 Second) {
+    for (uz I = 0; I < Count; ++I) {
+        if (Items[I] == First || Items[I] == Second) return I;
+    }
+
+    return Count;
+}
+
+static uz ScanSkipJsonWhitespace_Scalar(const u8 *Items, uz Count) {
+    for (uz I = 0; I < Count; ++I) {
+        if (!ScanIsJsonWhitespace(Items[I])) return I;
+    }
+
+    return Count;
+}
+
+static uz ScanFindJsonStringSpecial_Scalar(const u8 *Items, uz Count) {
+    for (uz I = 0; I < Count; ++I) {
+        if (ScanIsJsonStringSpecial(Items[I])) return I;
+    }
+
+    return Count;
+}
+
+#if SCAN_X86_KERNELS
+
+// 2. SSE2 kernels, 16 bytes at a time.
+
+static uz ScanFindByte_Sse2(const u8 *Items, uz Count, u8 Byte) {
+    __m128i Needle = _mm_set1_epi8((char)Byte);
+
+    uz I = 0;
+    for (; I + 16 <= Count; I += 16) {
+        __m128i Block = _mm_loadu_si128((const __m128i *)(Items + I));
+        u32 Mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(Block, Needle));
+        if (Mask != 0) return I + __builtin_ctz(Mask);
+    }
+
+    return I + ScanFindByte_Scalar(Items + I, Count - I, Byte);
+}
+
+static uz ScanFindByte2_Sse2(const u8 *Items, uz Count, u8 First, u8 Second) {
+    __m128i FirstNeedle = _mm_set1_epi8((char)First);
+    __m128i SecondNeedle = _mm_set1_epi8((char)Second);
+
+    uz I = 0;
+    for (; I + 16 <= Count; I += 16) {
+        __m128i Block = _mm_loadu_si128((const __m128i *)(Items + I));
+        __m128i Matches = _mm_or_si128(_mm_cmpeq_epi8(Block, FirstNeedle), _mm_cmpeq_epi8(Block, SecondNeedle));
+        u32 Mask = (u32)_mm_movemask_epi8(Matches);
+        if (Mask != 0) return I + __builtin_ctz(Mask);
+    }
+
+    return I + ScanFindByte2_Scalar(Items + I, Count - I, First, Second);
+}
+
+static uz ScanSkipJsonWhitespace_Sse2(const u8 *Items, uz Count) {
+    // NOTE(oleh): Most runs of whitespace are a single byte long, don't bother with a vector for those.
+    if (Count == 0 || !ScanIsJsonWhitespace(Items[0])) return 0;
+
+    __m128i Space = _mm_set1_epi8(0x20);
+    __m128i LineFeed = _mm_set1_epi8(0x0A);
+    __m128i CarriageReturn = _mm_set1_epi8(0x0D);
+    __m128i Tab = _mm_set1_epi8(0x09);
+
+    uz I = 0;
+    for (; I + 16 <= Count; I += 16) {
+        __m128i Block = _mm_loadu_si128((const __m128i *)(Items + I));
+        __m128i Whitespace = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(Block, Space), _mm_cmpeq_epi8(Block, LineFeed)),
+                                          _mm_or_si128(_mm_cmpeq_epi8(Block, CarriageReturn), _mm_cmpeq_epi8(Block, Tab)));
+        u32 Mask = ~(u32)_mm_movemask_epi8(Whitespace) & 0xFFFF;
+        if (Mask != 0) return I + __builtin_ctz(Mask);
+    }
+
+    return I + ScanSkipJsonWhitespace_Scalar(Items + I, Count - I);
+}
+
+// NOTE(oleh): There is no unsigned byte comparison, a byte is a control character if clamping
+// it to 0x1F leaves it unchanged.
+static uz ScanFindJsonStringSpecial_Sse2(const u8 *Items, uz Count) {
+    __m128i Quote = _mm_set1_epi8('"');
+    __m128i Backslash = _mm_set1_epi8('\\');
+    __m128i LastControl = _mm_set1_epi8(0x1F);
+
+    uz I = 0;
+    for (; I + 16 <= Count; I += 16) {
+        __m128i Block = _mm_loadu_si128((const __m128i *)(Items + I));
+        __m128i Special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(Block, Quote), _mm_cmpeq_epi8(Block, Backslash)),
+                                       _mm_cmpeq_epi8(_mm_min_epu8(Block, LastControl), Block));
+        u32 Mask = (u32)_mm_movemask_epi8(Special);
+        if (Mask != 0) return I + __builtin_ctz(Mask);
+    }
+
+    return I + ScanFindJsonStringSpecial_Scalar(Items + I, Count - I);
+}
+
+// 3. AVX2 kernels, 32 bytes at a time. Most HTTP and JSON tokens are short, so the first
+// 16 bytes are probed on their own. The remainder is handled right here: calling into the
+// legacy-encoded SSE2 kernels with dirty upper halves of the ymm registers stalls the CPU.
+
+__attribute__((target("avx2")))
+static uz ScanFindByte_Avx2(const u8 *Items, uz Count, u8 Byte) {
+    __m256i Needle = _mm256_set1_epi8((char)Byte);
+
+    uz I = 0;
+    if (Count >= 16) {
+        __m128i Block = _mm_loadu_si128((const __m128i *)Items);
+        u32 Mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(Block, _mm256_castsi256_si128(Needle)));
+        if (Mask != 0) return __builtin_ctz(Mask);
+        I = 16;
+    }
+
+    for (; I + 32 <= Count; I += 32) {
+        __m256i Block = _mm256_loadu_si256((const __m256i *)(Items + I));
+        u32 Mask = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(Block, Needle));
+        if (Mask != 0) return I + __builtin_ctz(Mask);
+    }
+
+    if (I + 16 <= Count) {
+        __m128i Block = _mm_loadu_si128((const __m128i *)(Items + I));
+        u32 Mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(Block, _mm256_castsi256_si128(Needle)));
+        if (Mask != 0) return I + __builtin_ctz(Mask);
+        I += 16;
+    }
+
+    for (; I < Count; ++I) {
+        if (Items[I] == Byte) return I;
+    }
+
+    return Count;
+}
+
+__attribute__((target("avx2")))
+static uz ScanFindByte2_Avx2(const u8 *Items, uz Count, u8 First, u8 Second) {
+    __m256i FirstNeedle = _mm256_set1_epi8((char)First);
+    __m256i SecondNeedle = _mm256_set1_epi8((char)Second);
+
+    uz I = 0;
+    if (Count >= 16) {
+        __m128i Block = _mm_loadu_si128((const __m128i *)Items);
+        __m128i Matches = _mm_or_si128(_mm_cmpeq_epi8(Block, _mm256_castsi256_si128(FirstNeedle)),
+                                       _mm_cmpeq_epi8(Block, _mm256_castsi256_si128(SecondNeedle)));
+        u32 Mask = (u32)_mm_movemask_epi8(Matches);
+        if (Mask != 0) return __builtin_ctz(Mask);
+        I = 16;
+    }
+
+    for (; I + 32 <= Count; I += 32) {
+        __m256i Block = _mm256_loadu_si256((const __m256i *)(Items + I));
+        __m256i Matches = _mm256_or_si256(_mm256_cmpeq_epi8(Block, FirstNeedle), _mm256_cmpeq_epi8(Block, SecondNeedle));
+        u32 Mask = (u32)_mm256_movemask_epi8(Matches);
+        if (Mask != 0) return I + __builtin_ctz(Mask);
+    }
+
+    if (I + 16 <= Count) {
+        __m128i Block = _mm_loadu_si128((const __m128i *)(Items + I));
+        __m128i Matches = _mm_or_si128(_mm_cmpeq_epi8(Block, _mm256_castsi256_si128(FirstNeedle)),
+                                       _mm_cmpeq_epi8(Block, _mm256_castsi256_si128(SecondNeedle)));
+        u32 Mask = (u32)_mm_movemask_epi8(Matches);
+        if (Mask != 0) return I + __builtin_ctz(Mask);
+        I += 16;
+    }
+
+    for (; I < Count; ++I) {
+        if (Items[I] == First || Items[I] == Second) return I;
+    }
+
+    return Count;
+}
+
+__attribute__((target("avx2")))
+static uz ScanSkipJsonWhitespace_Avx2(const u8 *Items, uz Count) {
+    if (Count == 0 || !ScanIsJsonWhitespace(Items[0])) return 0;
+
+    __m256i Space = _mm256_set1_epi8(0x20);
+    __m256i LineFeed = _mm256_set1_epi8(0x0A);
+    __m256i CarriageReturn = _mm256_set1_epi8(0x0D);
+    __m256i Tab = _mm256_set1_epi8(0x09);
+
+    uz I = 0;
+    for (; I + 32 <= Count; I += 32) {
+        __m256i Block = _mm256_loadu_si256((const __m256i *)(Items + I));
+        __m256i Whitespace = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(Block, Space), _mm256_cmpeq_epi8(Block, LineFeed)),
+                                             _mm256_or_si256(_mm256_cmpeq_epi8(Block, CarriageReturn), _mm256_cmpeq_epi8(Block, Tab)));
+        u32 Mask = ~(u32)_mm256_movemask_epi8(Whitespace);
+        if (Mask != 0) return I + __builtin_ctz(Mask);
+    }
+
+    for (; I < Count; ++I) {
+        if (!ScanIsJsonWhitespace(Items[I])) return I;
+    }
+
+    return Count;
+}
+
+__attribute__((target("avx2")))
+static uz ScanFindJsonStringSpecial_Avx2(const u8 *Items, uz Count) {
+    __m256i Quote = _mm256_set1_epi8('"');
+    __m256i Backslash = _mm256_set1_epi8('\\');
+    __m256i LastControl = _mm256_set1_epi8(0x1F);
+
+    uz I = 0;
+    if (Count >= 16) {
+        __m128i Block = _mm_loadu_si128((const __m128i *)Items);
+        __m128i Special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(Block, _mm256_castsi256_si128(Quote)),
+                                                    _mm_cmpeq_epi8(Block, _mm256_castsi256_si128(Backslash))),
+                                       _mm_cmpeq_epi8(_mm_min_epu8(Block, _mm256_castsi256_si128(LastControl)), Block));
+        u32 Mask = (u32)_mm_movemask_epi8(Special);
+        if (Mask != 0) return __builtin_ctz(Mask);
+        I = 16;
+    }
+
+    for (; I + 32 <= Count; I += 32) {
+        __m256i Block = _mm256_loadu_si256((const __m256i *)(Items + I));
+        __m256i Special = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(Block, Quote), _mm256_cmpeq_epi8(Block, Backslash)),
+                                          _mm256_cmpeq_epi8(_mm256_min_epu8(Block, LastControl), Block));
+        u32 Mask = (u32)_mm256_movemask_epi8(Special);
+        if (Mask != 0) return I + __builtin_ctz(Mask);
+    }
+
+    for (; I < Count; ++I) {
+        if (ScanIsJsonStringSpecial(Items[I])) return I;
+    }
+
+    return Count;
+}
+
+#endif // SCAN_X86_KERNELS
+
+// 4. Runtime dispatch. The first call through any entry point picks the kernels for all of them.
+
+typedef uz (*scan_find_byte)(const u8 *, uz, u8);
+typedef uz (*scan_find_byte2)(const u8 *, uz, u8, u8);
+typedef uz (*scan_skip_json_whitespace)(const u8 *, uz);
+typedef uz (*scan_find_json_string_special)(const u8 *, uz);
+
+static uz ScanFindByte_Resolve(const u8 *Items, uz Count, u8 Byte);
+static uz ScanFindByte2_Resolve(const u8 *Items, uz Count, u8 First, u8 Second);
+static uz ScanSkipJsonWhitespace_Resolve(const u8 *Items, uz Count);
+static uz ScanFindJsonStringSpecial_Resolve(const u8 *Items, uz Count);
+
+static scan_find_byte ScanFindByteKernel = ScanFindByte_Resolve;
+static scan_find_byte2 ScanFindByte2Kernel = ScanFindByte2_Resolve;
+static scan_skip_json_whitespace ScanSkipJsonWhitespaceKernel = ScanSkipJsonWhitespace_Resolve;
+static scan_find_json_string_special ScanFindJsonStringSpecialKernel = ScanFindJsonStringSpecial_Resolve;
+
+// NOTE(oleh): Every thread that races in here stores the same pointers, relaxed atomics are enough.
+static void ScanSelectKernels(void) {
+    scan_find_byte FindByte = ScanFindByte_Scalar;
+    scan_find_byte2 FindByte2 = ScanFindByte2_Scalar;
+    scan_skip_json_whitespace SkipJsonWhitespace = ScanSkipJsonWhitespace_Scalar;
+    scan_find_json_string_special FindJsonStringSpecial = ScanFindJsonStringSpecial_Scalar;
+
+#if SCAN_X86_KERNELS
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        FindByte = ScanFindByte_Avx2;
+        FindByte2 = ScanFindByte2_Avx2;
+        SkipJsonWhitespace = ScanSkipJsonWhitespace_Avx2;
+        FindJsonStringSpecial = ScanFindJsonStringSpecial_Avx2;
+    } else {
+        FindByte = ScanFindByte_Sse2;
+        FindByte2 = ScanFindByte2_Sse2;
+        SkipJsonWhitespace = ScanSkipJsonWhitespace_Sse2;
+        FindJsonStringSpecial = ScanFindJsonStringSpecial_Sse2;
+    }
+#endif
+
+    __atomic_store_n(&ScanFindByteKernel, FindByte, __ATOMIC_RELAXED);
+    __atomic_store_n(&ScanFindByte2Kernel, FindByte2, __ATOMIC_RELAXED);
+    __atomic_store_n(&ScanSkipJsonWhitespaceKernel, SkipJsonWhitespace, __ATOMIC_RELAXED);
+    __atomic_store_n(&ScanFindJsonStringSpecialKernel, FindJsonStringSpecial, __ATOMIC_RELAXED);
+}
+
+static uz ScanFindByte_Resolve(const u8 *Items, uz Count, u8 Byte) {
+    ScanSelectKernels();
+    return ScanFindByte(Items, Count, Byte);
+}
+
+static uz ScanFindByte2_Resolve(const u8 *Items, uz Count, u8 First, u8 Second) {
+    ScanSelectKernels();
+    return ScanFindByte2(Items, Count, First, Second);
+}
+
+static uz ScanSkipJsonWhitespace_Resolve(const u8 *Items, uz Count) {
+    ScanSelectKernels();
+    return ScanSkipJsonWhitespace(Items, Count);
+}
+
+static uz ScanFindJsonStringSpecial_Resolve(const u8 *Items, uz Count) {
+    ScanSelectKernels();
+    return ScanFindJsonStringSpecial(Items, Count);
+}
+
+uz ScanFindByte(const u8 *Items, uz Count, u8 Byte) {
+    return __atomic_load_n(&ScanFindByteKernel, __ATOMIC_RELAXED)(Items, Count, Byte);
+}
+
+uz ScanFindByte2(const u8 *Items, uz Count, u8 First, u8 Second) {
+    return __atomic_load_n(&ScanFindByte2Kernel, __ATOMIC_RELAXED)(Items, Count, First, Second);
+}
+
+uz ScanSkipJsonWhitespace(const u8 *Items, uz Count) {
+    return __atomic_load_n(&ScanSkipJsonWhitespaceKernel, __ATOMIC_RELAXED)(Items, Count);
+}
+
+uz ScanFindJsonStringSpecial(const u8 *Items, uz Count) {
+    return __atomic_load_n(&ScanFindJsonStringSpecialKernel, __ATOMIC_RELAXED)(Items, Count);
+}
@@ -0,0 +1,21 @@
+#ifndef SCAN_H_
+#define SCAN_H_
+
+#include "common.h"
+
+// NOTE(oleh): Delimiter scanning kernels shared by the HTTP parser and the JSON tokenizer.
+// The widest implementation the CPU supports (AVX2, then SSE2) is picked on the first call,
+// everything else falls back to plain loops. All of them return the index of the first
+// match, or `Count` if there is none.
+
+uz ScanFindByte(const u8 *Items, uz Count, u8 Byte);
+uz ScanFindByte2(const u8 *Items, uz Count, u8 First, u8 Second);
+
+// NOTE(oleh): Returns the index of the first byte that is not JSON whitespace (RFC 8259, section 2).
+uz ScanSkipJsonWhitespace(const u8 *Items, uz Count);
+
+// NOTE(oleh): Returns the index of the first byte that can't appear inside a JSON string as is:
+// a quote, a backslash or a control character (RFC 8259, section 7).
+uz ScanFindJsonStringSpecial(const u8 *Items, uz Count);
+
+#endif // SCAN_H_
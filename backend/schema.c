@@ -0,0 +1,98 @@
+#include "schema.h"
+
+static const json_field SchemaFields_project_entity[] = {
+#define X(Type, Field) JSON_FIELD(project_entity, Type, Field)
+    DECLARE_PROJECT_ENTITY
+#undef X
+};
+
+static const json_field SchemaFields_project_update_entity[] = {
+#define X(Type, Field) JSON_FIELD(project_update_entity, Type, Field)
+    DECLARE_PROJECT_UPDATE_ENTITY
+#undef X
+};
+
+static const json_field SchemaFields_user_entity[] = {
+#define X(Type, Field) JSON_FIELD(user_entity, Type, Field)
+    DECLARE_USER_ENTITY
+#undef X
+};
+
+static const json_field SchemaFields_feature_entity[] = {
+#define X(Type, Field) JSON_FIELD(feature_entity, Type, Field)
+    DECLARE_FEATURE_ENTITY
+#undef X
+};
+
+static const json_field SchemaFields_login_request[] = {
+#define X(Type, Field) JSON_FIELD(login_request, Type, Field)
+    DECLARE_LOGIN_REQUEST
+#undef X
+};
+
+static const json_field SchemaFields_register_request[] = {
+#define X(Type, Field) JSON_FIELD(register_request, Type, Field)
+    DECLARE_REGISTER_REQUEST
+#undef X
+};
+
+#define X(Schema)                                                       \
+    b32 SchemaDecode_##Schema(arena *Arena, string_view Input, Schema *Out) { \
+        return JsonDecodeObject(Arena, Input, SchemaFields_##Schema, ARRAY_COUNT(SchemaFields_##Schema), Out); \
+    }
+ENUM_SCHEMAS
+#undef X
+
+// NOTE(oleh): Enums travel either as their index or as the string the frontend uses for them.
+
+static const string_view FeaturePriorityNames[] = {
+    [PRIORITY_LOW] = {.Items = (u8 *)"low", .Count = 3},
+    [PRIORITY_MEDIUM] = {.Items = (u8 *)"medium", .Count = 6},
+    [PRIORITY_HIGH] = {.Items = (u8 *)"high", .Count = 4},
+};
+
+static const string_view FeatureStateNames[] = {
+    [STATE_TODO] = {.Items = (u8 *)"todo", .Count = 4},
+    [STATE_IN_PROGRESS] = {.Items = (u8 *)"in-progress", .Count = 11},
+    [STATE_DONE] = {.Items = (u8 *)"done", .Count = 4},
+};
+
+static b32 SchemaDecodeEnum(const json_value *Value, const string_view *Names, uz NamesCount, u32 *Out) {
+    if (Value == NULL) return 0;
+
+    if (Value->Type == JSON_NUMBER) return JsonDecode_u32(Value, Out) && *Out < NamesCount;
+    if (Value->Type != JSON_STRING) return 0;
+
+    for (uz Index = 0; Index < NamesCount; ++Index) {
+        if (StringViewEqual(Names[Index], Value->String)) {
+            *Out = (u32)Index;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+b32 JsonDecode_feature_priority(const json_value *Value, void *Out) {
+    u32 Index;
+    if (!SchemaDecodeEnum(Value, FeaturePriorityNames, ARRAY_COUNT(FeaturePriorityNames), &Index)) return 0;
+    *(feature_priority *)Out = (feature_priority)Index;
+    return 1;
+}
+
+b32 JsonDecode_feature_state(const json_value *Value, void *Out) {
+    u32 Index;
+    if (!SchemaDecodeEnum(Value, FeatureStateNames, ARRAY_COUNT(FeatureStateNames), &Index)) return 0;
+    *(feature_state *)Out = (feature_state)Index;
+    return 1;
+}
+
+void JsonPut_feature_priority(json_writer *Writer, feature_priority Priority) {
+    ASSERT((uz)Priority < ARRAY_COUNT(FeaturePriorityNames));
+    JsonPutString(Writer, FeaturePriorityNames[Priority]);
+}
+
+void JsonPut_feature_state(json_writer *Writer, feature_state State) {
+    ASSERT((uz)State < ARRAY_COUNT(FeatureStateNames));
+    JsonPutString(Writer, FeatureStateNames[State]);
+}
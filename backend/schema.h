@@ -0,0 +1,55 @@
+#ifndef SCHEMA_H_
+#define SCHEMA_H_
+
+#include "common.h"
+#include "db.h"
+#include "json.h"
+
+// NOTE(oleh): Request payloads that are not entities themselves.
+
+#define DECLARE_LOGIN_REQUEST \
+    X(string_view, FirstName) \
+    X(string_view, LastName) \
+    X(string_view, Password)
+
+typedef struct {
+#define X(Type, Name) Type Name;
+    DECLARE_LOGIN_REQUEST
+#undef X
+} login_request;
+
+#define DECLARE_REGISTER_REQUEST \
+    X(string_view, FirstName) \
+    X(string_view, LastName) \
+    X(string_view, Password) \
+    X(string_view, Role)
+
+typedef struct {
+#define X(Type, Name) Type Name;
+    DECLARE_REGISTER_REQUEST
+#undef X
+} register_request;
+
+// NOTE(oleh): Decoders for the schemas above and in db.h, generated from their X-macros.
+// Strings in the result point into `Input` or `Arena`. Every field that is not optional must be present.
+
+#define ENUM_SCHEMAS \
+    X(project_entity) \
+    X(project_update_entity) \
+    X(user_entity) \
+    X(feature_entity) \
+    X(login_request) \
+    X(register_request)
+
+#define X(Schema) b32 SchemaDecode_##Schema(arena *Arena, string_view Input, Schema *Out);
+ENUM_SCHEMAS
+#undef X
+
+b32 JsonDecode_feature_priority(const json_value *Value, void *Out);
+b32 JsonDecode_feature_state(const json_value *Value, void *Out);
+
+// NOTE(oleh): Enums are written out as the strings the frontend uses.
+void JsonPut_feature_priority(json_writer *Writer, feature_priority Priority);
+void JsonPut_feature_state(json_writer *Writer, feature_state State);
+
+#endif // SCHEMA_H_
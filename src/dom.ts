@@ -199,7 +199,7 @@ function newFeatureFormOnSubmit(ev: Event) {
         project: activeProject,
     });
 
-    globalFeatureRepository.addFeature(newFeature);
+    globalFeatureRepository.addFeature(newFeature).then(() => renderProjectFeatures(activeProject));
 }
 
 type MessageLevel = "info" | "error";
@@ -324,10 +324,10 @@ async function displayFeatureDetails(feat: Feature): Promise<void> {
         return e;
     };
 
-    const pId = p("id");
-    const pName = p("name");
-    const pDescription = p("description");
-    const pCreationDate = p("creationDate");
+    const pId = p("Id");
+    const pName = p("Name");
+    const pDescription = p("Description");
+    const pCreationDate = p("CreationDate");
 
     const prioritySelect = document.createElement("select");
 
@@ -335,7 +335,7 @@ async function displayFeatureDetails(feat: Feature): Promise<void> {
         const opt = document.createElement("option");
         opt.value = value;
         opt.textContent = value;
-        if (feat.priority === value) opt.selected = true;
+        if (feat.Priority === value) opt.selected = true;
         prioritySelect.appendChild(opt);
     };
 
@@ -344,21 +344,21 @@ async function displayFeatureDetails(feat: Feature): Promise<void> {
     prio("high");
 
     prioritySelect.addEventListener("change", () => {
-        feat.priority = prioritySelect.value as FeaturePriority;
+        feat.Priority = prioritySelect.value as FeaturePriority;
         globalFeatureRepository.updateFeature(feat);
     });
 
-    const project = await globalProjectRepository.queryByID(feat.projectID);
-    if (!project) throw new Error(`No project with id ${feat.projectID}`);
+    const project = await globalProjectRepository.queryByID(feat.ProjectId);
+    if (!project) throw new Error(`No project with id ${feat.ProjectId}`);
 
     const pProject = document.createElement("p");
-    pProject.textContent = `projectID: ${feat.projectID}(${project.Name})`;
+    pProject.textContent = `ProjectId: ${feat.ProjectId}(${project.Name})`;
 
-    const owner = await globalUserRepository.queryByID(feat.ownerID);
-    if (!owner) throw new Error(`No user with id ${feat.ownerID}`);
+    const owner = await globalUserRepository.queryByID(feat.OwnerId);
+    if (!owner) throw new Error(`No user with id ${feat.OwnerId}`);
 
     const pOwner = document.createElement("p");
-    pOwner.textContent = `ownerID: ${feat.ownerID}(${owner.FirstName} ${owner.LastName})`;
+    pOwner.textContent = `OwnerId: ${feat.OwnerId}(${owner.FirstName} ${owner.LastName})`;
 
     const stateSelect = document.createElement("select");
 
@@ -366,7 +366,7 @@ async function displayFeatureDetails(feat: Feature): Promise<void> {
         const opt = document.createElement("option");
         opt.value = value;
         opt.textContent = value;
-        if (feat.state === value) opt.selected = true;
+        if (feat.State === value) opt.selected = true;
         stateSelect.appendChild(opt);
     };
 
@@ -374,9 +374,9 @@ async function displayFeatureDetails(feat: Feature): Promise<void> {
     state("in-progress");
     state("done");
 
-    stateSelect.addEventListener("change", () => {
-        feat.state = stateSelect.value as FeatureState;
-        globalFeatureRepository.updateFeature(feat);
+    stateSelect.addEventListener("change", async () => {
+        feat.State = stateSelect.value as FeatureState;
+        await globalFeatureRepository.updateFeature(feat);
 
         const currentProject = globalProjectRepository.getActive()!;
         renderProjectFeatures(currentProject);
@@ -396,8 +396,8 @@ async function displayFeatureDetails(feat: Feature): Promise<void> {
     showPopup(featureElem);
 }
 
-function renderProjectFeatures(proj: Project): void {
-    const features = globalFeatureRepository.getProjectFeatures(proj);
+async function renderProjectFeatures(proj: Project): Promise<void> {
+    const features = await globalFeatureRepository.getProjectFeatures(proj);
 
     const table = document.createElement("table");
     const tHead = document.createElement("thead");
@@ -408,7 +408,7 @@ function renderProjectFeatures(proj: Project): void {
     const dones = [];
 
     for (const feature of features) {
-        switch (feature.state) {
+        switch (feature.State) {
             case "todo": todos.push(feature); break;
             case "in-progress": doings.push(feature); break;
             case "done": dones.push(feature); break;
@@ -420,7 +420,7 @@ function renderProjectFeatures(proj: Project): void {
     const appendFeatureIfExists = (row: HTMLElement, feature: Feature | undefined) => {
         const cell = document.createElement("td");
         if (feature) {
-            cell.textContent = feature.name;
+            cell.textContent = feature.Name;
             cell.classList.add("pointer");
             cell.addEventListener("click", () => displayFeatureDetails(feature));
         }
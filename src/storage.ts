@@ -63,16 +63,10 @@ class LocalStorageProjectRepository implements ProjectRepository {
     }
 
     public async deleteByName(name: string): Promise<void> {
-        const projects = await this.queryAll();
-
-        for (const project of projects) {
-            if (project.Name === name) {
-                this.deleteByID(project.Id);
-                return;
-            }
-        }
+        const project = await this.queryByName(name);
+        if (!project) throw new Error(`No project with name '${name}' found`);
 
-        throw new Error(`No project with name '${name}' found`);
+        this.deleteByID(project.Id);
     }
 
     public update(params: ProjectUpdateParams): void {
@@ -83,13 +77,15 @@ class LocalStorageProjectRepository implements ProjectRepository {
     }
 
     public async queryByName(name: string): Promise<Project | null> {
-        const projects = await this.queryAll();
-
-        for (const project of projects) {
-            if (project.Name === name) return project;
-        }
+        const resp = await fetch(`${BACKEND_URL}/get-project-by-name`, {
+            method: "POST",
+            body: name,
+        });
+        if (!resp.ok) return null;
 
-        return null;
+        const json = await resp.json();
+        // TODO(oleh): Validation.
+        return json as Project;
     }
 
     public async queryByID(id: string): Promise<Project | null> {
@@ -217,14 +213,14 @@ export type FeaturePriority = "low" | "medium" | "high";
 export type FeatureState = "todo" | "in-progress" | "done";
 
 export type Feature = {
-    id: string;
-    name: string;
-    description: string;
-    priority: FeaturePriority;
-    projectID: string;
-    creationDate: string;
-    ownerID: string;
-    state: FeatureState;
+    Id: string;
+    Name: string;
+    Description: string;
+    Priority: FeaturePriority;
+    ProjectId: string;
+    CreationDate: string;
+    OwnerId: string;
+    State: FeatureState;
 };
 
 export function createNewFeatureRightNow(
@@ -245,87 +241,51 @@ export function createNewFeatureRightNow(
     const creationDate = (new Date()).toISOString();
 
     return {
-        id: crypto.randomUUID(),
-        ownerID: owner.Id,
-        projectID: project.Id,
-        state: "todo",
-        name,
-        description,
-        priority,
-        creationDate,
+        Id: crypto.randomUUID(),
+        Name: name,
+        Description: description,
+        Priority: priority,
+        ProjectId: project.Id,
+        CreationDate: creationDate,
+        OwnerId: owner.Id,
+        State: "todo",
     };
 }
 
 export interface FeatureRepository {
-    addFeature(feat: Feature): void;
-    getProjectFeatures(proj: Project): Feature[];
-    updateFeature(feat: Feature): void;
-};
-
-type FeatureRepositoryMutator = {
-    addFeature(feat: Feature): void;
-    updateFeature(feat: Feature): void;
+    addFeature(feat: Feature): Promise<void>;
+    getProjectFeatures(proj: Project): Promise<Feature[]>;
+    updateFeature(feat: Feature): Promise<void>;
 };
 
-class FeatureRepositoryState {
-    private static LOCAL_STORAGE_KEY = "feature-repository";
-
-    private features: Feature[] = [];
-
-    public constructor() {
-        const existingState = localStorage.getItem(FeatureRepositoryState.LOCAL_STORAGE_KEY);
-
-        if (!existingState) {
-            const thisString = JSON.stringify(this);
-            localStorage.setItem(FeatureRepositoryState.LOCAL_STORAGE_KEY, thisString);
-        } else {
-            const state = JSON.parse(existingState) as FeatureRepositoryState;
-            this.features = state.features;
-        }
-    }
-
-    public modify(cb: (mutator: FeatureRepositoryMutator) => void): void {
-        const state = this;
-
-        const mutator: FeatureRepositoryMutator = {
-            addFeature(feat: Feature): void {
-                state.features.push(feat);
-            },
-            updateFeature(feat: Feature): void {
-                feat;
-            },
-        };
-
-        cb(mutator);
-
-        const stateString = JSON.stringify(state);
-        localStorage.setItem(FeatureRepositoryState.LOCAL_STORAGE_KEY, stateString);
-    }
-
-    public getProjectFeatures(proj: Project): Feature[] {
-        return this.features.filter((feat) => feat.projectID === proj.Id);
+class BackendFeatureRepository implements FeatureRepository {
+    public async addFeature(feat: Feature): Promise<void> {
+        await fetch(`${BACKEND_URL}/insert-feature`, {
+            method: "POST",
+            body: JSON.stringify(feat),
+        });
     }
-}
-
-class LocalStorageFeatureRepository implements FeatureRepository {
-    private state: FeatureRepositoryState = new FeatureRepositoryState();
 
-    public addFeature(feat: Feature): void {
-        this.state.modify((mutator) => mutator.addFeature(feat));
-    }
+    public async getProjectFeatures(proj: Project): Promise<Feature[]> {
+        const resp = await fetch(`${BACKEND_URL}/projects/${encodeURIComponent(proj.Id)}/features`);
+        if (!resp.ok) return [];
 
-    public getProjectFeatures(proj: Project): Feature[] {
-        return this.state.getProjectFeatures(proj);
+        const json = await resp.json();
+        // TODO(oleh): Validation.
+        return json as Feature[];
     }
 
-    public updateFeature(feature: Feature): void {
-        this.state.modify((mutator) => mutator.updateFeature(feature));
+    public async updateFeature(feat: Feature): Promise<void> {
+        await fetch(`${BACKEND_URL}/update-feature`, {
+            method: "POST",
+            body: JSON.stringify(feat),
+        });
     }
 };
 
 const globalProjectRepository: ProjectRepository = new LocalStorageProjectRepository();
 const globalUserRepository: UserRepository = new LocalStorageUserRepository();
-const globalFeatureRepository: FeatureRepository = new LocalStorageFeatureRepository();
+const globalFeatureRepository: FeatureRepository = new BackendFeatureRepository();
 
 export {
     globalProjectRepository,